@@ -8,10 +8,16 @@
 #endif
 
 #include <eeprom_routines.h>
+#include <string.h>
 
 #include "ModbusRtu.h"
 #include "user.h"
 #include "interrupts.h"
+#include "flash.h"
+#include "settings.h"
+#include "boot.h"
+#include "calendar.h"
+#include "eventlog.h"
 
 #define EE_MODBUS_ID 1
 
@@ -109,7 +115,8 @@ enum
     EXC_FUNC_CODE = 1,
     EXC_ADDR_RANGE = 2,
     EXC_REGS_QUANT = 3,
-    EXC_EXECUTE = 4
+    EXC_EXECUTE = 4,
+    EXC_BUSY = 6
 };
 
 const unsigned char fctsupported[] = {
@@ -125,6 +132,7 @@ const unsigned char fctsupported[] = {
     MB_FC_REPORT_SLAVE_ID,
     MB_FC_READ_FILE_RECORD,
     MB_FC_WRITE_FILE_RECORD,
+    MB_FC_READ_FIFO_QUEUE,
     MB_FC_READ_DEVICE_ID,
     
     MB_FC_SYSTEM_COMMAND,
@@ -132,8 +140,7 @@ const unsigned char fctsupported[] = {
     MB_FC_READ_DEVICE_STATUS
 };
 
-#define T35  5
-#define MAX_BUFFER  140	//!< maximum size for the communication buffer in bytes
+#define MAX_BUFFER  FRAME_SLOT_SIZE	//!< maximum size for the communication buffer in bytes
 
 uint8_t _deviceStatus; // 0- Time set, 1 - need time set and sync
 uint8_t _u8id; //!< 0=master, 1..247=slave number
@@ -141,20 +148,51 @@ uint8_t _u8serno; //!< serial port: 0-Serial, 1..3-Serial1..Serial3
 uint8_t _u8txenpin; //!< flow control pin: 0=USB or RS-232 mode, >0=RS-485 mode
 uint8_t _u8state;
 uint8_t _u8lastError;
-uint8_t _au8Buffer[MAX_BUFFER];
+uint8_t *_au8Buffer; // frame slot shared with UART receiver
 uint8_t _u8BufferSize;
-uint8_t _u8lastRec;
-//uint16_t *_holdingRegs;
+// Register tables for fast path in interrupt, set by ModbusPoll
+uint16_t *_inputRegs = NULL;
+uint16_t *_holdingRegs = NULL;
 uint8_t _inputRegsCount, _holdingRegsCount;
 uint16_t _u16InCnt, _u16OutCnt, _u16errCnt;
 uint16_t _u16timeOut;
-uint32_t _u32time, _u32timeOut;
+uint32_t _u32timeOut;
 uint8_t _exceptionStatus = 0;
 
 uint8_t _lastFunction = 0;
 uint16_t _lastAddress = 0;
 uint16_t _lastCount = 0; // number of coils or registers or file length in bytes in last command 
 uint8_t _lastCommand = 0;
+// Bit per coil or holding register changed by master, cleared when taken
+uint16_t _coilsDirty = 0;
+uint32_t _holdingDirty = 0;
+
+// Replies to last commands. Master retries command when reply is lost,
+// identical retry within window is answered again without running it.
+// Single command request is kept whole, batch one by its start and a
+// second sum of the rest. Replies are kept without CRC, batch statuses
+// are packed 4 per byte
+#define REPLAY_CACHE_LEN 2
+#define REPLAY_REQUEST_MAX (COM_ADD3_LO + 1)
+#define REPLAY_BATCH_HEADER (COM_DATA + 1)
+#define REPLAY_REPLY_MAX (REPLAY_BATCH_HEADER + MB_BATCH_MAX_COMMANDS / 4)
+typedef struct
+{
+    uint8_t Request[REPLAY_REQUEST_MAX]; // Without CRC
+    uint8_t RequestLen;
+    uint16_t RequestCrc;
+    uint16_t RequestSum; // Bytes after Request, 0 for single command
+    uint8_t ReplyLen; // 0 - empty entry, unpacked length
+    bool Packed;
+    uint8_t Reply[REPLAY_REPLY_MAX];
+    unsigned long Time;
+} ReplayEntry;
+ReplayEntry _replayCache[REPLAY_CACHE_LEN];
+uint8_t _replayNext = 0;
+uint16_t _replayWindowMs = MODBUS_REPLAY_WINDOW_MS;
+// Request being processed is kept in _replayCache[_replayNext], reply is
+// stored by ModbusSendTxBuffer
+bool _replayStore = false;
 
 
 uint8_t ModbusUserCommandId;
@@ -166,12 +204,17 @@ uint8_t ModbusUserCommandAdditional2Lo;
 uint8_t ModbusUserCommandAdditional3Hi;
 uint8_t ModbusUserCommandAdditional3Lo;
 
+// Packed sub-commands of FC101 batch waiting for main loop
+#define USER_BATCH_SIZE 128
+uint8_t _userBatch[USER_BATCH_SIZE];
+uint8_t _userBatchTail = 0; // Next to run
+uint8_t _userBatchHead = 0; // End of queued sub-commands
+
 
 void ModbusInit(uint8_t u8id, uint8_t u8serno, uint8_t u8txenpin);
 void ModbusSendTxBuffer();
-int8_t ModbusGetRxBufferHeader();
-int8_t ModbusGetRxBuffer();
 uint16_t ModbusCalcCRC(uint8_t u8length);
+uint16_t ModbusCrc(uint8_t *buf, uint8_t u8length);
 uint8_t ModbusValidateAnswer();
 uint8_t ModbusValidateRequest();
 void ModbusGet_FC1();
@@ -189,7 +232,11 @@ int8_t ModbusProcess_FC21(); // Writing to EEPROM
 int8_t ModbusProcess_FC43(); // 43 / 14 (0x2B / 0x0E) Read Device Identification
 int8_t ModbusProcess_FC100(); // system commands
 int8_t ModbusProcess_FC101(); // user commands
+int8_t ModbusProcess_FC101Batch(); // several user commands
 int8_t ModbusProcess_FC102(); // Get device state
+int8_t ModbusProcess_FC24(); // Read event log
+bool ModbusReplay();
+void ModbusReplayStore();
 void ModbusBuildException(uint8_t u8exception); // build exception message
 /* _____PUBLIC FUNCTIONS_____________________________________________________ */
 
@@ -229,12 +276,23 @@ void ModbusBuildException(uint8_t u8exception); // build exception message
  * @overload Modbus::Modbus()
  */
 
-void Modbus(uint8_t u8serno, uint8_t u8txenpin)
+static uint8_t ModbusSettingID()
 {
-    uint8_t tmpModbusId = eeprom_read(EE_MODBUS_ID);
+    uint8_t tmpModbusId = SettingGet(EE_MODBUS_ID);
     if(tmpModbusId == 0xff)
         tmpModbusId = DEFAULT_MODBUS_ID;
-    ModbusInit(tmpModbusId, u8serno, u8txenpin);
+    return tmpModbusId;
+}
+
+void Modbus(uint8_t u8serno, uint8_t u8txenpin)
+{
+    ModbusInit(ModbusSettingID(), u8serno, u8txenpin);
+}
+
+// Slave id changed in EEPROM, nothing else is reset
+void ModbusLoadID()
+{
+    _u8id = ModbusSettingID();
 }
 
 void ModbusSetExceptionStatusBit(uint8_t bitNum, boolean value)
@@ -346,12 +404,10 @@ void ModbusSetID( uint8_t u8id_)
  * @return u8id	current slave address between 1 and 247
  * @ingroup setup
  */
-/*
 uint8_t ModbusGetID()
 {
     return _u8id;
 }
-*/
 /**
  * @brief
  * Initialize time-out parameter
@@ -471,46 +527,39 @@ uint8_t ModbusPoll(uint16_t discreteInputs, uint16_t *coils, uint16_t *inputRegs
 {
     _lastFunction = MB_FC_NONE;
     //bitClear(_exceptionStatus, MB_EXCEPTION_LAST_COMMAND_STATE);
-    //_inputRegs = inputRegs;
-    //_holdingRegs = holdingRegs;
+    LowIsrLock();
+    _inputRegs = inputRegs;
+    _holdingRegs = holdingRegs;
     _inputRegsCount = inputRegsCount;
     _holdingRegsCount = holdingRegsCount;
+    LowIsrUnlock();
 
 
-    // check if there is any incoming frame
-
-    uint8_t u8current = PortAvailable();
-
-    if (u8current == 0) return 0;
+    // check if there is any incoming frame, T35 is counted by Timer3
+    if (!PortFrameReady())
+        return 0;
 
-    // check T35 after frame end or still no frame end
-    if (u8current != _u8lastRec)
+    // Parse frame in place, receiver switches to the other slot
+    bool corrupt;
+    _au8Buffer = PortTakeFrame(&_u8BufferSize, &corrupt);
+    _u16InCnt++;
+    // Byte of this frame was lost in receiver, CRC can not be trusted
+    if (corrupt)
     {
-        _u8lastRec = u8current;
-        _u32time = millis() + T35;
-        return 0;
+        _u16errCnt++;
+        _u8lastError = (_u8BufferSize >= MAX_BUFFER) ? ERR_BUFF_OVERFLOW : ERR_BAD_CRC;
+        return _u8lastError;
     }
-    if (millis() < _u32time)
-        return 0;
-
-    _u8lastRec = 0;
-    int8_t i8state = ModbusGetRxBufferHeader();
-    _u8lastError = i8state;
-    if (i8state < 4) // Minimum request len
+    if (_u8BufferSize < 4) // Minimum request len
     {
-        PortClearReadBuffer();
-        return i8state;
+        _u8lastError = ERR_EXCEPTION;
+        return ERR_EXCEPTION;
     }
     // check slave id
     if (_au8Buffer[ ID ] != _u8id)
-    {
-        PortClearReadBuffer();
         return 0;
-    }
-    i8state = ModbusGetRxBuffer();
-    PortClearReadBuffer();
+    int8_t i8state = _u8BufferSize;
     _u8lastError = i8state;
-    
 
  
     // validate message: CRC, FCT, address and size
@@ -529,6 +578,15 @@ uint8_t ModbusPoll(uint16_t discreteInputs, uint16_t *coils, uint16_t *inputRegs
     _u32timeOut = millis() + (long) _u16timeOut;
     _u8lastError = 0;
 
+    // Commands are not idempotent, retry gets cached reply
+    _replayStore = false;
+    if (_au8Buffer[ FUNC ] == MB_FC_SYSTEM_COMMAND || _au8Buffer[ FUNC ] == MB_FC_USER_COMMAND)
+    {
+        if (ModbusReplay())
+            return 0;
+        _replayStore = true;
+    }
+
     // Before read exception ststus not change value
     if(_au8Buffer[ FUNC ] != MB_FC_READ_EXCEPTION_STATUS)
         ModbusSetExceptionStatusBit(MB_EXCEPTION_LAST_COMMAND_STATE, false);
@@ -561,6 +619,8 @@ uint8_t ModbusPoll(uint16_t discreteInputs, uint16_t *coils, uint16_t *inputRegs
             return ModbusProcess_FC20();
         case MB_FC_WRITE_FILE_RECORD:
             return ModbusProcess_FC21();
+        case MB_FC_READ_FIFO_QUEUE:
+            return ModbusProcess_FC24();
         case MB_FC_READ_DEVICE_ID:
             return ModbusProcess_FC43();
         case MB_FC_SYSTEM_COMMAND:
@@ -576,63 +636,160 @@ uint8_t ModbusPoll(uint16_t discreteInputs, uint16_t *coils, uint16_t *inputRegs
     return i8state;
 }
 
+/**
+ * @brief
+ * Called from low priority interrupt when frame ended (T35 silence).
+ * Frames for other slaves are dropped, valid FC3/FC4 reads are answered
+ * in place. Everything else, including errors, is left for ModbusPoll.
+ * Answer is not sent here, caller hands it to TX interrupt.
+ *
+ * @param replyLen answer length in frame, 0 - nothing to send
+ * @return true if frame is consumed
+ * @ingroup loop
+ */
+bool ModbusFastPath(uint8_t *frame, uint8_t len, uint8_t *replyLen)
+{
+    *replyLen = 0;
+    if (frame[ ID ] != _u8id)
+        return true;
+    if (len != 8 || (frame[ FUNC ] != MB_FC_READ_REGISTERS && frame[ FUNC ] != MB_FC_READ_INPUT_REGISTER))
+        return false;
+    if (ModbusCrc(frame, 6) != word(frame[ 6 ], frame[ 7 ]))
+        return false;
+    uint16_t *regs = _holdingRegs;
+    uint8_t size = _holdingRegsCount;
+    if (frame[ FUNC ] == MB_FC_READ_INPUT_REGISTER)
+    {
+        regs = _inputRegs;
+        size = _inputRegsCount;
+    }
+    if (regs == NULL)
+        return false;
+    uint16_t u16regs = word(frame[ ADD_HI ], frame[ ADD_LO ]);
+    uint16_t u16count = word(frame[ NB_HI ], frame[ NB_LO ]);
+    if (u16regs >= size || u16count > size - u16regs)
+        return false; // exception is built by main loop
+
+    bitClear(_exceptionStatus, MB_EXCEPTION_LAST_COMMAND_STATE);
+    frame[ 2 ] = u16count * 2;
+    len = 3;
+    for (uint8_t i = (uint8_t)u16regs; i < u16regs + u16count; i++)
+    {
+        frame[ len++ ] = HIGH_BYTE(regs[i]);
+        frame[ len++ ] = LOW_BYTE(regs[i]);
+    }
+    uint16_t u16crc = ModbusCrc(frame, len);
+    frame[ len++ ] = u16crc >> 8;
+    frame[ len++ ] = u16crc & 0x00ff;
+    *replyLen = len;
+    return true;
+}
+
 /* _____PRIVATE FUNCTIONS_____________________________________________________ */
 
-void ModbusInit(uint8_t u8id, uint8_t u8serno, uint8_t u8txenpin)
+void ModbusSetReplayWindow(uint16_t ms)
 {
-    _deviceStatus = 0;
-    if(DEVICE_NEED_TIME_SET)
-        bitSet(_deviceStatus, INPUT_NEED_TIME_SET);
-    _u8id = u8id;
-    _u8serno = (u8serno > 3) ? 0 : u8serno;
-    _u8txenpin = u8txenpin;
-    _u16timeOut = 1000;
+    _replayWindowMs = ms;
 }
 
-// Read first 4 bytes
-int8_t ModbusGetRxBufferHeader()
+// Fletcher style sum of request bytes after kept start, independent of CRC
+static uint16_t ModbusReplaySum()
 {
-    _u8BufferSize = 0;
-    for(uint8_t i = 0; i < 4; i++)
+    uint8_t sum1 = 0;
+    uint8_t sum2 = 0;
+    for (uint8_t j = REPLAY_REQUEST_MAX; j < _u8BufferSize - 2; j++)
     {
-        if(!PortAvailable())
-            return ERR_EXCEPTION;
-        _au8Buffer[ _u8BufferSize ] = PortRead();
-        _u8BufferSize++;
+        sum1 += _au8Buffer[j];
+        sum2 += sum1;
     }
-    return _u8BufferSize;
+    return word(sum2, sum1);
 }
 
 /**
  * @brief
- * This method moves Serial buffer data to the Modbus au8Buffer.
+ * Answer request from replay cache if the same one was processed within
+ * replay window. Single commands are compared byte by byte, batches by
+ * start, length, CRC and second sum. Otherwise remember request for
+ * caching reply.
  *
- * @return buffer size if OK, ERR_BUFF_OVERFLOW if u8BufferSize >= MAX_BUFFER
+ * @return true if cached reply was sent
  * @ingroup buffer
  */
-int8_t ModbusGetRxBuffer()
+bool ModbusReplay()
 {
-    bool bBuffOverflow = false;
-
-    //!!!  if (u8txenpin > 1) 
-    //!!!      digitalWrite( u8txenpin, LOW );
-
-    _u8BufferSize = 4;
+    uint8_t requestLen = _u8BufferSize - 2;
+    uint8_t keptLen = requestLen < REPLAY_REQUEST_MAX ? requestLen : REPLAY_REQUEST_MAX;
+    uint16_t crc = word(_au8Buffer[ requestLen ], _au8Buffer[ requestLen + 1 ]);
+    uint16_t sum = ModbusReplaySum();
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < REPLAY_CACHE_LEN; i++)
+    {
+        ReplayEntry *entry = &_replayCache[i];
+        if (entry->ReplyLen == 0 || entry->RequestLen != requestLen || entry->RequestCrc != crc)
+            continue;
+        if (entry->RequestSum != sum || memcmp(entry->Request, _au8Buffer, keptLen) != 0)
+            continue;
+        if (now - entry->Time >= _replayWindowMs)
+            continue;
+        for (uint8_t j = 0; j < entry->ReplyLen; j++)
+        {
+            if (!entry->Packed || j < REPLAY_BATCH_HEADER)
+                _au8Buffer[j] = entry->Reply[j];
+            else
+            {
+                uint8_t n = j - REPLAY_BATCH_HEADER;
+                _au8Buffer[j] = (entry->Reply[REPLAY_BATCH_HEADER + (n >> 2)] >> ((n & 0x03) << 1)) & 0x03;
+            }
+        }
+        _u8BufferSize = entry->ReplyLen;
+        _lastFunction = MB_FC_NONE; // command is not run again
+        ModbusSendTxBuffer();
+        return true;
+    }
+    // Entry is reused, it is valid again when reply is stored
+    ReplayEntry *entry = &_replayCache[_replayNext];
+    entry->ReplyLen = 0;
+    memcpy(entry->Request, _au8Buffer, keptLen);
+    entry->RequestLen = requestLen;
+    entry->RequestCrc = crc;
+    entry->RequestSum = sum;
+    return false;
+}
 
-    while (PortAvailable())
+// Keep reply in _au8Buffer, before CRC, for request remembered by ModbusReplay
+void ModbusReplayStore()
+{
+    ReplayEntry *entry = &_replayCache[_replayNext];
+    entry->Packed = _au8Buffer[ FUNC ] == MB_FC_USER_COMMAND && _au8Buffer[ COM_COM_ID ] == MB_COMMAND_BATCH;
+    if (entry->Packed)
     {
-        _au8Buffer[ _u8BufferSize ] = PortRead();
-        _u8BufferSize++;
-        if (_u8BufferSize >= MAX_BUFFER)
-            bBuffOverflow = true;
+        for (uint8_t j = 0; j < REPLAY_REPLY_MAX; j++)
+            entry->Reply[j] = j < REPLAY_BATCH_HEADER ? _au8Buffer[j] : 0;
+        for (uint8_t n = 0; n < _u8BufferSize - REPLAY_BATCH_HEADER; n++)
+            entry->Reply[REPLAY_BATCH_HEADER + (n >> 2)] |= (_au8Buffer[REPLAY_BATCH_HEADER + n] & 0x03) << ((n & 0x03) << 1);
     }
-    _u16InCnt++;
-    if (bBuffOverflow)
+    else if (_u8BufferSize <= REPLAY_REPLY_MAX)
     {
-        _u16errCnt++;
-        return ERR_BUFF_OVERFLOW;
+        for (uint8_t j = 0; j < _u8BufferSize; j++)
+            entry->Reply[j] = _au8Buffer[j];
     }
-    return _u8BufferSize;
+    else
+        return;
+    entry->ReplyLen = _u8BufferSize;
+    entry->Time = millis();
+    _replayNext = (_replayNext + 1) % REPLAY_CACHE_LEN;
+}
+
+void ModbusInit(uint8_t u8id, uint8_t u8serno, uint8_t u8txenpin)
+{
+    _deviceStatus = 0;
+    if(DEVICE_NEED_TIME_SET)
+        bitSet(_deviceStatus, INPUT_NEED_TIME_SET);
+    _u8id = u8id;
+    _u8serno = (u8serno > 3) ? 0 : u8serno;
+    _u8txenpin = u8txenpin;
+    _u16timeOut = 1000;
+    _au8Buffer = PortFrameBuffer();
 }
 
 /**
@@ -651,6 +808,12 @@ void ModbusSendTxBuffer()
 {
     //  uint8_t i = 0;
 
+    if (_replayStore)
+    {
+        _replayStore = false;
+        ModbusReplayStore();
+    }
+
     // append CRC to message
     uint16_t u16crc = ModbusCalcCRC(_u8BufferSize);
     _au8Buffer[ _u8BufferSize ] = u16crc >> 8;
@@ -658,7 +821,6 @@ void ModbusSendTxBuffer()
     _au8Buffer[ _u8BufferSize ] = u16crc & 0x00ff;
     _u8BufferSize++;
 
-
     // transfer buffer to serial line
     PortWrite(_au8Buffer, _u8BufferSize);
 
@@ -758,12 +920,18 @@ uint16_t ModbusCalcCRC(uint8_t u8length)
  * @ingroup buffer
  */
 uint16_t ModbusCalcCRC(uint8_t u8length)
+{
+    return ModbusCrc(_au8Buffer, u8length);
+}
+
+// Called from main loop and from fast path in interrupt
+uint16_t ModbusCrc(uint8_t *buf, uint8_t u8length)
 {
     unsigned int temp, temp2, flag;
     temp = 0xFFFF;
     for (uint8_t i = 0; i < u8length; i++)
     {
-        temp = temp ^ _au8Buffer[i];
+        temp = temp ^ buf[i];
         for (uint8_t j = 1; j <= 8; j++)
         {
             flag = temp & 0x0001;
@@ -796,14 +964,29 @@ uint8_t CheckFunc20()
     {
         if (_au8Buffer[offset + FILE_REF_TYPE ] != 6)
             return EXC_ADDR_RANGE;
-        // Support only file # 0x0001
-       if (_au8Buffer[offset + FILE_NUM_HI ] != 0x00 || _au8Buffer[offset +  FILE_NUM_LO ] != 0x01)
+        if (_au8Buffer[offset + FILE_NUM_HI ] != 0x00)
            return EXC_ADDR_RANGE;
-        unsigned long startAddrBytes = ((_au8Buffer[offset + FILE_REC_HI ] << 8) | _au8Buffer[offset + FILE_REC_LO ]) << 1;
         unsigned long recLenBytes = ((_au8Buffer[offset + FILE_REC_LEN_HI ] << 8) | _au8Buffer[offset + FILE_REC_LEN_LO ]) << 1;
-        if (startAddrBytes + recLenBytes >= _EEPROMSIZE)
+        if(_au8Buffer[offset + FILE_NUM_LO ] == MB_FILE_FLASH || _au8Buffer[offset + FILE_NUM_LO ] == MB_FILE_CONFIG_STAGE)
+        {
+            // Whole block with erase counter can be read. Staged image is
+            // read back before commit, the bank does not reach it
+            uint8_t blocks = _au8Buffer[offset + FILE_NUM_LO ] == MB_FILE_FLASH ? FLASH_BANK_BLOCKS : FLASH_STAGING_BLOCKS;
+            if (_au8Buffer[offset + FILE_REC_HI ] != 0x00 || _au8Buffer[offset + FILE_REC_LO ] >= blocks)
+                return EXC_ADDR_RANGE;
+            if (recLenBytes > FLASH_BLOCK_SIZE)
+                return EXC_ADDR_RANGE;
+        }
+        else if(_au8Buffer[offset + FILE_NUM_LO ] == MB_FILE_EEPROM)
+        {
+            unsigned long startAddrBytes = ((_au8Buffer[offset + FILE_REC_HI ] << 8) | _au8Buffer[offset + FILE_REC_LO ]) << 1;
+            if (startAddrBytes + recLenBytes >= _EEPROMSIZE)
+                return EXC_ADDR_RANGE;
+        }
+        else
             return EXC_ADDR_RANGE;
-        if(resultLen + recLenBytes + 2 > MAX_BUFFER - 3)
+        // Answer header and CRC must fit too
+        if(resultLen + recLenBytes + 2 > MAX_BUFFER - 5)
             return EXC_ADDR_RANGE;
         resultLen += recLenBytes + 2;
         offset += 7;
@@ -816,6 +999,15 @@ uint8_t CheckFunc20()
 }
 
 
+// True if count addresses from start all have their bit set in writable mask
+bool ModbusRangeWritable(uint32_t writable, uint16_t start, uint16_t count)
+{
+    if (count == 0 || start > 31 || count > 32 - start)
+        return false;
+    uint32_t bits = (count == 32) ? 0xFFFFFFFF : ((1UL << count) - 1);
+    return ((writable >> start) & bits) == bits;
+}
+
 /**
  * @brief
  * This method validates slave incoming messages
@@ -857,9 +1049,7 @@ uint8_t ModbusValidateRequest()
     uint8_t u8regs;
     switch (_au8Buffer[ FUNC ])
     {
-        case MB_FC_READ_COILS:
         case MB_FC_READ_DISCRETE_INPUT:
-        case MB_FC_WRITE_MULTIPLE_COILS:
             // Всего может быть до 16 адресов
             u16regs = word(_au8Buffer[ ADD_HI ], _au8Buffer[ ADD_LO ]);
             u16count = word(_au8Buffer[ NB_HI ], _au8Buffer[ NB_LO ]);
@@ -868,32 +1058,52 @@ uint8_t ModbusValidateRequest()
             if (u16regs > 15 || u16regs + u16count > 16)
                 return EXC_ADDR_RANGE;
             break;
+            // Coil and register limits come from tables in user.h
+        case MB_FC_READ_COILS:
+            u16regs = word(_au8Buffer[ ADD_HI ], _au8Buffer[ ADD_LO ]);
+            u16count = word(_au8Buffer[ NB_HI ], _au8Buffer[ NB_LO ]);
+            if (u16count > 16)
+                return EXC_REGS_QUANT;
+            if (u16regs >= modbusCoilsCount || u16count > modbusCoilsCount - u16regs)
+                return EXC_ADDR_RANGE;
+            break;
+        case MB_FC_WRITE_MULTIPLE_COILS:
+            u16regs = word(_au8Buffer[ ADD_HI ], _au8Buffer[ ADD_LO ]);
+            u16count = word(_au8Buffer[ NB_HI ], _au8Buffer[ NB_LO ]);
+            if (u16count > 16)
+                return EXC_REGS_QUANT;
+            if (!ModbusRangeWritable(MB_COILS_WRITABLE, u16regs, u16count))
+                return EXC_ADDR_RANGE;
+            break;
         case MB_FC_WRITE_COIL:
             u16regs = word(_au8Buffer[ ADD_HI ], _au8Buffer[ ADD_LO ]);
             u8regs = _au8Buffer[ NB_HI ];
             if (u8regs != 0x00 && u8regs != 0xFF)
                 return EXC_REGS_QUANT;
-            if (u16regs > 15)
+            if (!ModbusRangeWritable(MB_COILS_WRITABLE, u16regs, 1))
                 return EXC_ADDR_RANGE;
             break;
         case MB_FC_WRITE_REGISTER:
             u16regs = word(_au8Buffer[ ADD_HI ], _au8Buffer[ ADD_LO ]);
-            u8regs = (uint8_t) u16regs;
-            if (u8regs > _holdingRegsCount) return EXC_ADDR_RANGE;
+            if (!ModbusRangeWritable(MB_HOLDING_WRITABLE, u16regs, 1))
+                return EXC_ADDR_RANGE;
             break;
         case MB_FC_READ_INPUT_REGISTER: // 4
             u16regs = word(_au8Buffer[ ADD_HI ], _au8Buffer[ ADD_LO ]);
-            u16regs += word(_au8Buffer[ NB_HI ], _au8Buffer[ NB_LO ]);
-            u8regs = (uint8_t) u16regs;
-            if (u8regs > _inputRegsCount)
+            u16count = word(_au8Buffer[ NB_HI ], _au8Buffer[ NB_LO ]);
+            if (u16regs >= _inputRegsCount || u16count > _inputRegsCount - u16regs)
                 return EXC_ADDR_RANGE;
             break;
         case MB_FC_READ_REGISTERS:
+            u16regs = word(_au8Buffer[ ADD_HI ], _au8Buffer[ ADD_LO ]);
+            u16count = word(_au8Buffer[ NB_HI ], _au8Buffer[ NB_LO ]);
+            if (u16regs >= _holdingRegsCount || u16count > _holdingRegsCount - u16regs)
+                return EXC_ADDR_RANGE;
+            break;
         case MB_FC_WRITE_MULTIPLE_REGISTERS:
             u16regs = word(_au8Buffer[ ADD_HI ], _au8Buffer[ ADD_LO ]);
-            u16regs += word(_au8Buffer[ NB_HI ], _au8Buffer[ NB_LO ]);
-            u8regs = (uint8_t) u16regs;
-            if (u8regs > _holdingRegsCount)
+            u16count = word(_au8Buffer[ NB_HI ], _au8Buffer[ NB_LO ]);
+            if (!ModbusRangeWritable(MB_HOLDING_WRITABLE, u16regs, u16count))
                 return EXC_ADDR_RANGE;
             break;
         case MB_FC_REPORT_SLAVE_ID:
@@ -910,14 +1120,24 @@ uint8_t ModbusValidateRequest()
         case MB_FC_WRITE_FILE_RECORD:
             if (_au8Buffer[ FILE_REF_TYPE ] != 6)
                 return EXC_ADDR_RANGE;
-            // Support only file # 0x0001
-            if (_au8Buffer[ FILE_NUM_HI ] != 0x00 || _au8Buffer[ FILE_NUM_LO ] != 0x01)
+            if (_au8Buffer[ FILE_NUM_HI ] != 0x00)
                 return EXC_ADDR_RANGE;
-            // Test for EEPROM range
             unsigned long startAddrBytes = ((_au8Buffer[ FILE_REC_HI ] << 8) | _au8Buffer[ FILE_REC_LO ]) << 1;
             unsigned long recLenBytes = ((_au8Buffer[ FILE_REC_LEN_HI ] << 8) | _au8Buffer[ FILE_REC_LEN_LO ]) << 1;
-
-            if (startAddrBytes + recLenBytes >= _EEPROMSIZE)
+            if (_au8Buffer[ FILE_NUM_LO ] == MB_FILE_FLASH || _au8Buffer[ FILE_NUM_LO ] == MB_FILE_CONFIG_STAGE)
+            {
+                // One erase block data per request
+                uint8_t blocks = _au8Buffer[ FILE_NUM_LO ] == MB_FILE_FLASH ? FLASH_BANK_BLOCKS : FLASH_STAGING_BLOCKS;
+                if (_au8Buffer[ FILE_REC_HI ] != 0x00 || _au8Buffer[ FILE_REC_LO ] >= blocks)
+                    return EXC_ADDR_RANGE;
+                if (recLenBytes != FLASH_BLOCK_PAYLOAD)
+                    return EXC_ADDR_RANGE;
+                break;
+            }
+            if (_au8Buffer[ FILE_NUM_LO ] != MB_FILE_EEPROM)
+                return EXC_ADDR_RANGE;
+            // Test for EEPROM range, settings journal is not writable
+            if (startAddrBytes + recLenBytes > SETTINGS_JOURNAL_START)
                 return EXC_ADDR_RANGE;
             break;
         case MB_FC_READ_DEVICE_ID:
@@ -933,13 +1153,41 @@ uint8_t ModbusValidateRequest()
         case MB_FC_SYSTEM_COMMAND:
             if(_au8Buffer[COM_COM_ID] != MB_COMMAND_RESET 
                     && _au8Buffer[COM_COM_ID] != MB_COMMAND_SET_ADDRESS 
-                    && _au8Buffer[COM_COM_ID] != MB_COMMAND_SET_TIME)
+                    && _au8Buffer[COM_COM_ID] != MB_COMMAND_SET_TIME
+                    && _au8Buffer[COM_COM_ID] != MB_COMMAND_CONFIG_COMMIT
+                    && _au8Buffer[COM_COM_ID] != MB_COMMAND_FIRMWARE_UPDATE)
+                return EXC_REGS_QUANT;
+            if(_au8Buffer[COM_COM_ID] == MB_COMMAND_CONFIG_COMMIT)
+            {
+                if(_au8Buffer[COM_ADD1_HI] != 0 || _au8Buffer[COM_ADD1_LO] == 0
+                        || _au8Buffer[COM_ADD1_LO] > SETTINGS_JOURNAL_START)
+                    return EXC_REGS_QUANT;
+                // Checked again before copy, staging may change after commit
+                if(SettingsStagedCrc(_au8Buffer[COM_ADD1_LO]) != word(_au8Buffer[COM_ADD2_HI], _au8Buffer[COM_ADD2_LO]))
+                    return EXC_EXECUTE;
+            }
+            if(_au8Buffer[COM_COM_ID] == MB_COMMAND_FIRMWARE_UPDATE
+                    && _au8Buffer[COM_DATA] != BOOT_ENTER_KEY)
+                return EXC_REGS_QUANT;
+            if(_au8Buffer[COM_COM_ID] == MB_COMMAND_SET_TIME
+                    && (_au8Buffer[COM_ADD1_HI] > 23 || _au8Buffer[COM_ADD1_LO] > 59 || _au8Buffer[COM_ADD2_LO] > 59
+                    || _au8Buffer[COM_ADD2_HI] == 0 || _au8Buffer[COM_ADD2_HI] > 31
+                    || _au8Buffer[COM_ADD3_HI] > 11 || _au8Buffer[COM_ADD3_LO] > 99))
                 return EXC_REGS_QUANT;
             break;
         case MB_FC_USER_COMMAND:   
+            if(_au8Buffer[COM_COM_ID] == MB_COMMAND_BATCH
+                    && (_au8Buffer[COM_DATA] == 0 || _au8Buffer[COM_DATA] > MB_BATCH_MAX_COMMANDS))
+                return EXC_REGS_QUANT;
+            // Queued after batch to keep order, master retries later
+            if(_au8Buffer[COM_COM_ID] != MB_COMMAND_BATCH && _userBatchTail != _userBatchHead
+                    && _userBatchHead + UserCommandSize(_au8Buffer[COM_COM_ID]) > USER_BATCH_SIZE)
+                return EXC_BUSY;
             break;
         case MB_FC_READ_DEVICE_STATUS:            
             break;
+        case MB_FC_READ_FIFO_QUEUE: // Any pointer, unknown one reads from oldest record
+            break;
     }
     _lastFunction = _au8Buffer[ FUNC ];
     return 0; // OK, no exception code thrown
@@ -973,6 +1221,20 @@ uint8_t *ModbusGetLastCommand(uint16_t *address, uint16_t *count, uint8_t *comma
     return &_lastFunction;
 }
 
+uint16_t ModbusTakeCoilsDirty()
+{
+    uint16_t dirty = _coilsDirty;
+    _coilsDirty = 0;
+    return dirty;
+}
+
+uint32_t ModbusTakeHoldingDirty()
+{
+    uint32_t dirty = _holdingDirty;
+    _holdingDirty = 0;
+    return dirty;
+}
+
 /**
  * @brief
  * This method processes functions 1 & 2
@@ -1084,10 +1346,15 @@ int8_t ModbusProcess_FC5(uint16_t *regs)
     u8currentBit = (uint8_t) (u16coil % 16);
 
     // write to coil
-    bitWrite(
-            *regs,
-            u8currentBit,
-            _au8Buffer[ NB_HI ] == 0xff);
+    bool value = _au8Buffer[ NB_HI ] == 0xff;
+    if (bitRead(*regs, u8currentBit) != value)
+    {
+        bitWrite(
+                *regs,
+                u8currentBit,
+                value);
+        bitSet(_coilsDirty, u8currentBit);
+    }
 
 
     // send answer to master
@@ -1114,7 +1381,11 @@ int8_t ModbusProcess_FC6(uint16_t *regs, uint8_t u8size)
     uint8_t u8CopyBufferSize;
     uint16_t u16val = word(_au8Buffer[ NB_HI ], _au8Buffer[ NB_LO ]);
 
-    regs[ u16add ] = u16val;
+    if (regs[ u16add ] != u16val)
+    {
+        ModbusRegWrite(regs[ u16add ], u16val);
+        _holdingDirty |= 1UL << u16add;
+    }
 
     // keep the same header
     _u8BufferSize = RESPONSE_SIZE;
@@ -1170,10 +1441,14 @@ int8_t ModbusProcess_FC15(uint16_t *regs)
                 _au8Buffer[ u8frameByte ],
                 u8bitsno);
 
-        bitWrite(
-                *regs,
-                u8currentBit,
-                bTemp);
+        if (bitRead(*regs, u8currentBit) != bTemp)
+        {
+            bitWrite(
+                    *regs,
+                    u8currentBit,
+                    bTemp);
+            bitSet(_coilsDirty, u8currentBit);
+        }
 
         u8bitsno++;
 
@@ -1223,7 +1498,11 @@ int8_t ModbusProcess_FC16(uint16_t *regs, uint8_t u8size)
                 _au8Buffer[ (BYTE_CNT + 1) + i * 2 ],
                 _au8Buffer[ (BYTE_CNT + 2) + i * 2 ]);
 
-        regs[ u16StartAdd + i ] = temp;
+        if (regs[ u16StartAdd + i ] != temp)
+        {
+            ModbusRegWrite(regs[ u16StartAdd + i ], temp);
+            _holdingDirty |= 1UL << (u16StartAdd + i);
+        }
     }
     u8CopyBufferSize = _u8BufferSize + 2;
     ModbusSendTxBuffer();
@@ -1274,12 +1553,18 @@ int8_t ModbusProcess_FC20()
     uint8_t offset = 0;
 
     
-    uint8_t startAddrBytes[5];
+    uint8_t fileNums[5];
+    uint8_t startAddrBytes[5]; // block number for flash
     uint8_t recLenBytes[5];
     uint8_t reqCount = 0;
     while(offset < requestDataLen)
     {
-        startAddrBytes[reqCount] = (_au8Buffer[offset + FILE_REC_LO ]) << 1;
+        fileNums[reqCount] = _au8Buffer[offset + FILE_NUM_LO ];
+        startAddrBytes[reqCount] = _au8Buffer[offset + FILE_REC_LO ];
+        if(fileNums[reqCount] == MB_FILE_EEPROM)
+            startAddrBytes[reqCount] <<= 1;
+        if(fileNums[reqCount] == MB_FILE_CONFIG_STAGE)
+            startAddrBytes[reqCount] += FLASH_STAGING_FIRST_BLOCK;
         recLenBytes[reqCount] = (_au8Buffer[offset + FILE_REC_LEN_LO ]) << 1;
         reqCount++;
         offset += 7;
@@ -1293,17 +1578,25 @@ int8_t ModbusProcess_FC20()
     {
         _au8Buffer[offset++] = recLenBytes[r] + 1;
         _au8Buffer[offset++] = 6;
+        if(fileNums[r] == MB_FILE_FLASH || fileNums[r] == MB_FILE_CONFIG_STAGE)
+        {
+            for(uint8_t i = 0; i < recLenBytes[r]; i++)
+                _au8Buffer[offset++] = FlashReadRaw(startAddrBytes[r], i);
+            continue;
+        }
         if(startAddrBytes[r] < _lastAddress)
             _lastAddress = startAddrBytes[r];
         
         for(uint8_t i = 0; i < recLenBytes[r]; i++)
         {
-            _au8Buffer[offset++] = eeprom_read(startAddrBytes[r] + i);//_EEREG_EEPROM_READ
+            uint8_t address = startAddrBytes[r] + i;
+            // Journal area is returned raw
+            _au8Buffer[offset++] = address < SETTINGS_JOURNAL_START ? SettingGet(address) : eeprom_read(address);
         }
         if(startAddrBytes[r] + recLenBytes[r] > _lastCount)
             _lastCount = startAddrBytes[r] + recLenBytes[r];
     }
-    _au8Buffer[ FILE_DATA_LEN ] = offset - 2;// += recLenBytes[r] + 2;
+    _au8Buffer[ FILE_DATA_LEN ] = offset - (FILE_DATA_LEN + 1); // sub-responses, without header
     //        _EEREG_EEPROM_READ
 
     
@@ -1314,7 +1607,7 @@ int8_t ModbusProcess_FC20()
     // build header
     //au8Buffer[ NB_HI ]   = 0;
     //au8Buffer[ NB_LO ]   = u8regsno;
-    _u8BufferSize = _au8Buffer[ FILE_DATA_LEN ] + 1;
+    _u8BufferSize = offset;
 
     u8CopyBufferSize = _u8BufferSize; // +2;
     ModbusSendTxBuffer();
@@ -1336,6 +1629,20 @@ int8_t ModbusProcess_FC21()
 
     uint8_t requestDataLen = _au8Buffer[ FILE_DATA_LEN ];
 
+    if(_au8Buffer[ FILE_NUM_LO ] == MB_FILE_FLASH || _au8Buffer[ FILE_NUM_LO ] == MB_FILE_CONFIG_STAGE)
+    {
+        // HI - file, LO - block. Count - erase count after write
+        uint8_t block = _au8Buffer[ FILE_REC_LO ];
+        _lastAddress = word(_au8Buffer[ FILE_NUM_LO ], block);
+        if(_au8Buffer[ FILE_NUM_LO ] == MB_FILE_CONFIG_STAGE)
+            block += FLASH_STAGING_FIRST_BLOCK;
+        _lastCount = FlashWriteBlock(block, &_au8Buffer[ FILE_FIRST_BYTE ]);
+        _u8BufferSize = FILE_DATA_LEN + 1 + requestDataLen; // echo
+        uint8_t u8CopyBufferSize = _u8BufferSize;
+        ModbusSendTxBuffer();
+        return u8CopyBufferSize;
+    }
+
     uint16_t startAddrsBytes = (word(_au8Buffer[ FILE_REC_HI ], _au8Buffer[ FILE_REC_LO ])) << 1;
     _lastAddress = startAddrsBytes;
     uint16_t recLenBytes = (word(_au8Buffer[ FILE_REC_LEN_HI ], _au8Buffer[ FILE_REC_LEN_LO ])) << 1;
@@ -1347,13 +1654,17 @@ int8_t ModbusProcess_FC21()
     // build header
     //au8Buffer[ NB_HI ]   = 0;
     //au8Buffer[ NB_LO ]   = u8regsno;
-    _u8BufferSize = requestDataLen + 1;
+    _u8BufferSize = FILE_DATA_LEN + 1 + requestDataLen; // answer is echo of request
 
 
     // write EEPROM
     for (i = 0; i < recLenBytes; i++)
     {
-        eeprom_write(startAddrsBytes + i, _au8Buffer[ FILE_FIRST_BYTE + i ]);
+        // Settings bytes go to journal
+        if(SettingIsKey(startAddrsBytes + i))
+            SettingSet(startAddrsBytes + i, _au8Buffer[ FILE_FIRST_BYTE + i ]);
+        else
+            EepromUpdate(startAddrsBytes + i, _au8Buffer[ FILE_FIRST_BYTE + i ]);
     }
     // wait for write end
     while(WR)
@@ -1464,44 +1775,71 @@ int8_t ModbusProcess_FC100()
     switch(_lastCommand)
     {
         case MB_COMMAND_RESET:
-            #asm
-                RESET; 
-            #endasm
+            RESET();
             break;
         case MB_COMMAND_SET_ADDRESS:
             _u8id = _au8Buffer[COM_DATA];
-            eeprom_write(EE_MODBUS_ID, _u8id);
-            while(WR)
-                continue;
+            SettingSet(EE_MODBUS_ID, _u8id);
             ModbusSetExceptionStatusBit(MB_EXCEPTION_LAST_COMMAND_STATE, true);
             break;  
+        case MB_COMMAND_CONFIG_COMMIT:
+            // Copied by main loop after answer, or on boot if power is lost
+            SettingsStageCommit(_au8Buffer[COM_ADD1_LO], word(_au8Buffer[COM_ADD2_HI], _au8Buffer[COM_ADD2_LO]));
+            ModbusSetExceptionStatusBit(MB_EXCEPTION_LAST_COMMAND_STATE, true);
+            break;
         case MB_COMMAND_SET_TIME:
+        {
+            // ADD3 HI - month 0..11, LO - year from 2000, ADD2 HI - day
+            uint16_t newDate = DaysFromCivil(_au8Buffer[COM_ADD3_LO], _au8Buffer[COM_ADD3_HI], _au8Buffer[COM_ADD2_HI]);
+            time_t newRawTime = CalendarToTime(newDate, _au8Buffer[COM_ADD1_HI], _au8Buffer[COM_ADD1_LO], _au8Buffer[COM_ADD2_LO]);
+            // Compare with own clock before it is set
+            WatchCalibrate(&newRawTime);
             SetHourMin(&(_au8Buffer[COM_ADD1_HI]), &(_au8Buffer[COM_ADD1_LO]), &(_au8Buffer[COM_ADD2_LO]));
-            
-            //----------------
-            struct tm newTime;
-            newTime.tm_year = _au8Buffer[COM_ADD3_LO] + 100; // since 1900
-            newTime.tm_mon = _au8Buffer[COM_ADD3_HI];
-            newTime.tm_mday = _au8Buffer[COM_ADD2_HI];
-            newTime.tm_hour = _au8Buffer[COM_ADD1_HI];
-            newTime.tm_min = _au8Buffer[COM_ADD1_LO];
-            newTime.tm_sec = _au8Buffer[COM_ADD2_LO];
-            time_t newRawTime = mktime(&newTime);
             SetTime(&newRawTime);
-            //----------------
+            SetDate(newDate);
             bitSet(_deviceStatus, INPUT_TIME_SET);
             ModbusSetExceptionStatusBit(MB_EXCEPTION_LAST_COMMAND_STATE, true);
             break;
+        }
     }
     uint8_t u8CopyBufferSize = _u8BufferSize + 2;
     ModbusSendTxBuffer();
 
     return u8CopyBufferSize;
 }
+uint8_t UserCommandSize(uint8_t commandId)
+{
+    switch(commandId)
+    {
+        case MB_COMMAND_CLEAR_ALL_EVENTS:
+            return MB_COMMAND_CLEAR_ALL_EVENTS_SIZE;
+        case MB_COMMAND_SET_LED:
+            return MB_COMMAND_SET_LED_SIZE;
+        case MB_COMMAND_SET_STATUS_LED:
+            return MB_COMMAND_SET_STATUS_LED_SIZE;
+        case MB_COMMAND_PLAY_SOUND_NUM:
+            return MB_COMMAND_PLAY_SOUND_NUM_SIZE;
+    }
+    return 0;
+}
+
 // user commands
 int8_t ModbusProcess_FC101()
 {
+    if (_au8Buffer[COM_COM_ID] == MB_COMMAND_BATCH)
+        return ModbusProcess_FC101Batch();
     _u8BufferSize = 10;
+    // Batch sub-commands are still running, this one must not overtake them
+    uint8_t size = UserCommandSize(_au8Buffer[COM_COM_ID]);
+    if (_userBatchTail != _userBatchHead && size != 0)
+    {
+        for (uint8_t j = 0; j < size; j++)
+            _userBatch[ _userBatchHead++ ] = _au8Buffer[ COM_COM_ID + j ];
+        ModbusUserCommandId = MB_COMMAND_BATCH; // nothing to run in io_poll
+        uint8_t u8CopyBufferSize = _u8BufferSize + 2;
+        ModbusSendTxBuffer();
+        return u8CopyBufferSize;
+    }
     ModbusUserCommandId = _au8Buffer[COM_COM_ID];
     ModbusUserCommandData = _au8Buffer[COM_DATA];
     ModbusUserCommandAdditional1Hi = _au8Buffer[COM_ADD1_HI];
@@ -1517,6 +1855,116 @@ int8_t ModbusProcess_FC101()
     return u8CopyBufferSize;
 }
 
+/**
+ * @brief
+ * FC101 batch: COM_DATA - sub-commands count, then packed sub-commands.
+ * Sub-command is command id, data and additional bytes, its size is given
+ * by UserCommandSize. Sub-commands are queued and run in order by main
+ * loop, answer has queue status of every sub-command.
+ *
+ * @return u8BufferSize Response to master length
+ * @ingroup register
+ */
+int8_t ModbusProcess_FC101Batch()
+{
+    uint8_t count = _au8Buffer[ COM_DATA ];
+    uint8_t end = _u8BufferSize - 2; // without CRC
+    uint8_t pos = COM_DATA + 1;
+    bool parsing = true;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint8_t status = MB_BATCH_UNKNOWN;
+        uint8_t size = parsing && pos < end ? UserCommandSize(_au8Buffer[ pos ]) : 0;
+        if (size == 0 || pos + size > end)
+            parsing = false; // size of the rest is unknown
+        else
+        {
+            status = MB_BATCH_QUEUE_FULL;
+            if (_userBatchHead + size <= USER_BATCH_SIZE)
+            {
+                for (uint8_t j = 0; j < size; j++)
+                    _userBatch[ _userBatchHead++ ] = _au8Buffer[ pos + j ];
+                status = MB_BATCH_QUEUED;
+            }
+            pos += size;
+        }
+        // Sub-command i starts at or after its status byte and is read already
+        _au8Buffer[ COM_DATA + 1 + i ] = status;
+    }
+    ModbusUserCommandId = MB_COMMAND_BATCH; // nothing to run in io_poll
+    _u8BufferSize = COM_DATA + 1 + count;
+    uint8_t u8CopyBufferSize = _u8BufferSize + 2;
+    ModbusSendTxBuffer();
+
+    return u8CopyBufferSize;
+}
+
+bool ModbusTakeBatchCommand()
+{
+    if (_userBatchTail == _userBatchHead)
+        return false;
+    uint8_t command[COM_ADD3_LO - COM_COM_ID + 1] = {0};
+    uint8_t size = UserCommandSize(_userBatch[ _userBatchTail ]);
+    for (uint8_t i = 0; i < size && i < sizeof(command); i++)
+        command[i] = _userBatch[ _userBatchTail + i ];
+    _userBatchTail += size;
+    if (_userBatchTail >= _userBatchHead)
+        _userBatchTail = _userBatchHead = 0;
+
+    ModbusUserCommandId = command[ COM_COM_ID - COM_COM_ID ];
+    ModbusUserCommandData = command[ COM_DATA - COM_COM_ID ];
+    ModbusUserCommandAdditional1Hi = command[ COM_ADD1_HI - COM_COM_ID ];
+    ModbusUserCommandAdditional1Lo = command[ COM_ADD1_LO - COM_COM_ID ];
+    ModbusUserCommandAdditional2Hi = command[ COM_ADD2_HI - COM_COM_ID ];
+    ModbusUserCommandAdditional2Lo = command[ COM_ADD2_LO - COM_COM_ID ];
+    ModbusUserCommandAdditional3Hi = command[ COM_ADD3_HI - COM_COM_ID ];
+    ModbusUserCommandAdditional3Lo = command[ COM_ADD3_LO - COM_COM_ID ];
+    return true;
+}
+
+/**
+ * @brief
+ * This method processes function 24 Read FIFO Queue
+ * FIFO pointer is sequence number of next record master expects, records
+ * before it are dropped. Answer: sequence number of first record, then
+ * EVENT_LOG_RECORD_REGS registers per record.
+ *
+ * @return u8BufferSize Response to master length
+ * @ingroup register
+ */
+int8_t ModbusProcess_FC24()
+{
+    uint8_t count = EventLogAck(word(_au8Buffer[ ADD_HI ], _au8Buffer[ ADD_LO ]));
+    if (count > EVENT_LOG_READ_MAX)
+        count = EVENT_LOG_READ_MAX;
+    uint8_t regsCount = 1 + count * EVENT_LOG_RECORD_REGS;
+    uint16_t seq = EventLogFirstSeq();
+
+    _au8Buffer[ 2 ] = 0;
+    _au8Buffer[ 3 ] = (regsCount + 1) << 1; // byte count includes FIFO count
+    _au8Buffer[ 4 ] = 0;
+    _au8Buffer[ 5 ] = regsCount;
+    _au8Buffer[ 6 ] = HIGH_BYTE(seq);
+    _au8Buffer[ 7 ] = LOW_BYTE(seq);
+    _u8BufferSize = 8;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint8_t type, data;
+        time_t time;
+        EventLogGet(i, &type, &data, &time);
+        _au8Buffer[ _u8BufferSize++ ] = type;
+        _au8Buffer[ _u8BufferSize++ ] = data;
+        _au8Buffer[ _u8BufferSize++ ] = (uint8_t)(time >> 24);
+        _au8Buffer[ _u8BufferSize++ ] = (uint8_t)(time >> 16);
+        _au8Buffer[ _u8BufferSize++ ] = (uint8_t)(time >> 8);
+        _au8Buffer[ _u8BufferSize++ ] = (uint8_t)time;
+    }
+    uint8_t u8CopyBufferSize = _u8BufferSize + 2;
+    ModbusSendTxBuffer();
+
+    return u8CopyBufferSize;
+}
+
 int8_t ModbusProcess_FC102()
 {
     _au8Buffer[FUNC + 1] = _deviceStatus;
@@ -69,6 +69,8 @@
 
 #define DEVICE_NEED_TIME_SET 1
 
+#define MODBUS_REPLAY_WINDOW_MS 1000 // Identical command within is answered from cache
+
 #define VENDOR_NAME "BOLID"
 #define PRODUCT_CODE "C2000-BI"
 #define MAJOR_MINOR_REVISION "1.01"
@@ -88,6 +90,30 @@
 #define MB_COMMAND_RESET 0x7F
 #define MB_COMMAND_SET_ADDRESS 0x01
 #define MB_COMMAND_SET_TIME 0x10
+#define MB_COMMAND_CONFIG_COMMIT 0x20 // ADD1 - staged image length, ADD2 - its CRC16
+#define MB_COMMAND_FIRMWARE_UPDATE 0x7E // Data - BOOT_ENTER_KEY, answer then start boot block
+
+// FC101 batch of user commands, answer has status byte per sub-command
+#define MB_COMMAND_BATCH 0xA0
+#define MB_BATCH_MAX_COMMANDS 64
+#define MB_BATCH_QUEUED 0x00
+#define MB_BATCH_UNKNOWN 0x01 // Unknown command, or size of it is unknown
+#define MB_BATCH_QUEUE_FULL 0x02
+
+// Custom Commands, run by application. Size is what batch sub-command
+// takes: id, data, then ADD1 and ADD2 bytes as far as command uses them.
+// Master library keeps the same sizes (host/c2000bi/protocol.cpp)
+#define MB_COMMAND_CLEAR_ALL_EVENTS 0x80
+#define MB_COMMAND_CLEAR_ALL_EVENTS_SIZE 2
+//#define MB_COMMAND_ADD_EVENT 0x81
+#define MB_COMMAND_SET_LED 0x82
+#define MB_COMMAND_SET_LED_SIZE 6
+#define MB_COMMAND_SET_STATUS_LED 0x83 // Data - HighBit - On/Off, low 3 bits: FIRE, WARNING, Alarm, Napadeniye, NOT_RESPONSE
+#define MB_COMMAND_SET_STATUS_LED_SIZE 4
+// Additional: HI - sound Id, LO playDuration * 256msec 0 - once
+//#define MB_COMMAND_TEST_SOUND 0x90 // Play sound 2 seconds LO: Period, Additional: duration (10 bit))
+#define MB_COMMAND_PLAY_SOUND_NUM 0x91 // Data - sound id, Additional: HI - priority (0 - info, at most warning), LO playDuration,sec 0 - once
+#define MB_COMMAND_PLAY_SOUND_NUM_SIZE 4
 
 #define MB_EXCEPTION_LAST_COMMAND_STATE 0
 
@@ -115,6 +141,7 @@ enum MB_FC
     MB_FC_REPORT_SLAVE_ID = 17,             /*!< FCT=17 -> Report Slave ID */
     MB_FC_READ_FILE_RECORD = 20,
     MB_FC_WRITE_FILE_RECORD = 21,           // (0x15) Write File Record
+    MB_FC_READ_FIFO_QUEUE = 24,             // (0x18) Read FIFO Queue, device event log
     MB_FC_READ_DEVICE_ID = 43,               //43 / 14 (0x2B / 0x0E) Read Device Identification
     
     MB_FC_SYSTEM_COMMAND = 100,
@@ -122,6 +149,16 @@ enum MB_FC
     MB_FC_READ_DEVICE_STATUS = 102
 };
 
+// Files for FC20 / FC21. Answers have standard Modbus lengths: FC21 echoes
+// whole request, FC20 byte count covers sub-responses only. Firmware before
+// this change answered both 2 bytes short, masters parsing those lengths
+// have to be updated
+#define MB_FILE_EEPROM 1 // Record number - EEPROM word address
+#define MB_FILE_FLASH 2 // Record number - flash storage block, FC21 writes whole block data
+#define MB_FILE_FIRMWARE 3 // Record number - image row, written by boot block only (boot.h)
+#define MB_FILE_CONFIG_STAGE 4 // Record number - staging block, EEPROM image for MB_COMMAND_CONFIG_COMMIT
+
+
 
 //  Modbus();
 //  Modbus(uint8_t u8id, uint8_t u8serno);
@@ -134,18 +171,26 @@ enum MB_FC
 //   int8_t query( modbus_t telegram ); //!<only for master
 //   int8_t poll(); //!<cyclic poll for master
 
-  int8_t ModbusPoll(uint16_t discreteInputs, uint16_t *coils, uint16_t *inputRegs, const uint8_t inputRegsCount, 
+  uint8_t ModbusPoll(uint16_t discreteInputs, uint16_t *coils, uint16_t *inputRegs, const uint8_t inputRegsCount, 
     uint16_t *holdingRegs, const uint8_t holdingRegsCount); //!<cyclic poll for slave
 
+  bool ModbusFastPath(uint8_t *frame, uint8_t len, uint8_t *replyLen); //!<answer register reads from interrupt
+  void ModbusSetReplayWindow(uint16_t ms); //!<time retried command is answered from cache
+  bool ModbusTakeBatchCommand(); //!<load next queued batch sub-command as user command
+  uint8_t UserCommandSize(uint8_t commandId); //!<batch sub-command size, 0 - can not be batched
+
   uint16_t ModbusGetInCnt(); //!<number of incoming messages
   uint16_t ModbusGetOutCnt(); //!<number of outcoming messages
   uint16_t ModbusGetErrCnt(); //!<error counter
   uint8_t ModbusGetID(); //!<get slave ID between 1 and 247
+  void ModbusLoadID(); //!<reload slave ID from settings
   uint8_t ModbusGetState();
   uint8_t ModbusGetLastError(); //!<get last error message
   void ModbusSetID( uint8_t u8id ); //!<write new ID for the slave
   void ModbusEnd(); //!<finish any communication and release serial communication port
   uint8_t *ModbusGetLastCommand(uint16_t *address, uint16_t *count, uint8_t *command);
+  uint16_t ModbusTakeCoilsDirty(); //!<coils changed by master since last call, bit per coil
+  uint32_t ModbusTakeHoldingDirty(); //!<holding registers changed by master since last call
   void ModbusSetExceptionStatusBit(uint8_t bitNum, boolean value);
   
   uint8_t *ModbusGetUserCommandId();
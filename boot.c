@@ -0,0 +1,340 @@
+/******************************************************************************/
+/*Files to Include                                                            */
+/******************************************************************************/
+
+#if defined(__XC)
+    #include <xc.h>         /* XC8 General Include File */
+#elif defined(HI_TECH_C)
+    #include <htc.h>        /* HiTech General Include File */
+#elif defined(__18CXX)
+    #include <p18cxxx.h>    /* C18 General Include File */
+#endif
+
+#if defined(__XC) || defined(HI_TECH_C)
+
+#include <stdint.h>         /* For uint8_t definition */
+#include <stdbool.h>        /* For true/false definition */
+
+#endif
+
+#include "system.h"
+#include "flash.h"
+#include "settings.h"
+#include "ModbusRtu.h"
+#include "interrupts.h"
+#include "boot.h"
+
+#if BOOT_FRAME_SIZE + BOOT_ROW_SIZE > 2 * FRAME_SLOT_SIZE
+#error "Boot buffers do not fit in frame slots"
+#endif
+
+// Boot block must work when application rows are erased, so BootMain
+// calls nothing outside of it and has no const tables (they would be
+// placed in application rows), helpers are macros.
+
+#define BOOT_EXC_FUNC_CODE 1
+#define BOOT_EXC_ADDR_RANGE 2
+#define BOOT_EXC_EXECUTE 4
+
+#define BOOT_TXE_DELAY 10
+
+#if BOOT_START != 0x7800u || BOOT_APP_START != 0x0040u
+#error "Update boot vectors and BootReset"
+#endif
+
+// Row 0 is written by programmer together with boot block and is never
+// erased by it: reset goes to BootReset, interrupts to the vectors of
+// application moved by --codeoffset
+#asm
+    PSECT bootvectors,class=CODE,abs
+    ORG 0x0000
+    GOTO 0x7800 ; BootReset
+    ORG 0x0008
+    GOTO 0x0048 ; application high priority interrupt
+    ORG 0x0018
+    GOTO 0x0058 ; application low priority interrupt
+#endasm
+
+#define BootCrcByte(crc, b) do { \
+        crc ^= (b); \
+        for (uint8_t k = 0; k < 8; k++) \
+            crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1; \
+    } while(0)
+
+#define BootSetTablePointer(address) do { \
+        TBLPTRU = 0; \
+        TBLPTRH = (uint8_t)((address) >> 8); \
+        TBLPTRL = (uint8_t)(address); \
+    } while(0)
+
+// Interrupts are off in boot block. CPU stalls until operation ends
+#define BootUnlockAndWrite() do { \
+        EECON2 = 0x55; \
+        EECON2 = 0xAA; \
+        WR = 1; \
+        asm("NOP"); \
+    } while(0)
+
+#define BootEraseRow(address) do { \
+        EEPGD = 1; \
+        CFGS = 0; \
+        WREN = 1; \
+        BootSetTablePointer(address); \
+        FREE = 1; \
+        BootUnlockAndWrite(); \
+        FREE = 0; \
+        WREN = 0; \
+    } while(0)
+
+// Application starts only when its reset vector is programmed
+#define BootEntryErased(erased) do { \
+        EEPGD = 1; \
+        CFGS = 0; \
+        BootSetTablePointer(BOOT_APP_START); \
+        asm("TBLRD*+"); \
+        erased = TABLAT == 0xFF; \
+        asm("TBLRD*+"); \
+        erased = erased && TABLAT == 0xFF; \
+    } while(0)
+
+void BootEnter(uint8_t slaveId)
+{
+    EepromUpdate(BOOT_EE_ID, slaveId);
+    while (WR)
+        continue;
+    di();
+    BootMain();
+}
+
+void BootReset(void) @ BOOT_START
+{
+    bool erased;
+    BootEntryErased(erased);
+    EEPGD = 0;
+    if (!erased)
+        asm("GOTO 0x0040");
+    BootMain();
+}
+
+void BootMain(void) @ BOOT_MAIN
+{
+    // Application is dead here, its frame slots hold boot buffers, so
+    // boot block takes no RAM from it
+    uint8_t *frame = _frameSlots[0];
+    uint8_t *entryRow = frame + BOOT_FRAME_SIZE;
+    bool haveEntryRow = false;
+    bool entryErased;
+    uint16_t crc;
+
+    di();
+    // Started from reset vector or from application, set up everything used
+    INTCON = 0;
+    PIE1 = 0;
+    PIE2 = 0;
+    T2CONbits.TMR2ON = 0; // buzzer
+    TXSTA = 0;
+    TXSTAbits.TXEN = 1;
+    TXSTAbits.BRGH = 1;
+    SPBRG = UBRG;
+    RCSTA = 0;
+    RCSTAbits.SPEN = 1;
+    RCSTAbits.CREN = 1;
+    TRISCbits.RC5 = 0;
+    LATCbits.LATC5 = 0;
+    T3CON = 0;
+    T3CONbits.RD16 = 1;
+
+    EEADR = BOOT_EE_ID;
+    EEPGD = 0;
+    CFGS = 0;
+    RD = 1;
+    uint8_t id = EEDATA;
+
+    BootEntryErased(entryErased);
+    EEPGD = 0;
+
+    for (;;)
+    {
+        // Frame ends after T35 silence, timer is started by first byte
+        uint8_t len = 0;
+        bool corrupt = false;
+        T3CONbits.TMR3ON = 0;
+        PIR2bits.TMR3IF = 0;
+        while (!PIR2bits.TMR3IF)
+        {
+            if (!PIR1bits.RCIF)
+                continue;
+            T3CONbits.TMR3ON = 0;
+            WRITETIMER3(0x10000 - TIMER3_T35_TICKS);
+            PIR2bits.TMR3IF = 0;
+            T3CONbits.TMR3ON = 1;
+            if (RCSTAbits.OERR)
+            {
+                RCSTAbits.CREN = 0;
+                RCSTAbits.CREN = 1;
+                while (PIR1bits.RCIF)
+                    (void)RCREG;
+                corrupt = true;
+                continue;
+            }
+            if (RCSTAbits.FERR)
+                corrupt = true;
+            uint8_t c = RCREG;
+            if (len < BOOT_FRAME_SIZE)
+                frame[len++] = c;
+            else
+                corrupt = true;
+        }
+        T3CONbits.TMR3ON = 0;
+
+        if (corrupt || len < 5 || frame[0] != id)
+            continue;
+        crc = 0xFFFF;
+        for (uint8_t i = 0; i < len - 2; i++)
+            BootCrcByte(crc, frame[i]);
+        if (frame[len - 2] != (uint8_t)crc || frame[len - 1] != (uint8_t)(crc >> 8))
+            continue;
+
+        uint8_t exception = 0;
+        bool reset = false;
+        if (frame[1] != MB_FC_WRITE_FILE_RECORD)
+            exception = BOOT_EXC_FUNC_CODE;
+        else if (frame[2] != len - 5)
+            exception = BOOT_EXC_ADDR_RANGE;
+        uint8_t pos = 3;
+        while (exception == 0 && pos < len - 2)
+        {
+            // Sub-request: ref type 6, file, record, length in words, data
+            uint16_t record = word(frame[pos + 3], frame[pos + 4]);
+            uint16_t words = word(frame[pos + 5], frame[pos + 6]);
+            uint8_t *data = &frame[pos + 7];
+            if (frame[pos] != 6 || frame[pos + 1] != 0 || frame[pos + 2] != MB_FILE_FIRMWARE
+                    || words > BOOT_ROW_WORDS || pos + 7 + words * 2 > len - 2)
+            {
+                exception = BOOT_EXC_ADDR_RANGE;
+                break;
+            }
+            pos += 7 + words * 2;
+
+            uint16_t address = BOOT_APP_START;
+            uint8_t *src = entryRow;
+            if (record == BOOT_FINISH_RECORD)
+            {
+                // Data: rows count, CRC. Image is verified with new entry row
+                uint16_t rows = word(data[0], data[1]);
+                if (words != 2 || !haveEntryRow || rows <= BOOT_APP_ROW || rows > BOOT_IMAGE_ROWS)
+                {
+                    exception = BOOT_EXC_ADDR_RANGE;
+                    break;
+                }
+                crc = 0xFFFF;
+                for (uint8_t i = 0; i < BOOT_ROW_SIZE; i++)
+                    BootCrcByte(crc, entryRow[i]);
+                EEPGD = 1;
+                BootSetTablePointer(BOOT_APP_START + BOOT_ROW_SIZE);
+                for (uint16_t n = (rows - BOOT_APP_ROW - 1) << 6; n != 0; n--)
+                {
+                    asm("TBLRD*+");
+                    BootCrcByte(crc, TABLAT);
+                }
+                if (crc != word(data[2], data[3]))
+                {
+                    exception = BOOT_EXC_EXECUTE;
+                    break;
+                }
+                reset = true;
+            }
+            else
+            {
+                // Row 0 holds boot vectors, it is not part of the image
+                if (words != BOOT_ROW_WORDS || record < BOOT_APP_ROW || record >= BOOT_IMAGE_ROWS)
+                {
+                    exception = BOOT_EXC_ADDR_RANGE;
+                    break;
+                }
+                if (record == BOOT_APP_ROW)
+                {
+                    for (uint8_t i = 0; i < BOOT_ROW_SIZE; i++)
+                        entryRow[i] = data[i];
+                    haveEntryRow = true;
+                    continue;
+                }
+                address = record << 6;
+                src = data;
+            }
+
+            // Old application must not start from partly written image
+            if (!entryErased)
+            {
+                BootEraseRow(BOOT_APP_START);
+                BootEntryErased(entryErased);
+                if (!entryErased)
+                {
+                    exception = BOOT_EXC_EXECUTE;
+                    break;
+                }
+            }
+
+            BootEraseRow(address);
+            // 8-byte blocks from the last one, so reset vector of entry
+            // row is written last. TBLPTR must stay in the block while
+            // it is written
+            WREN = 1;
+            for (uint8_t block = BOOT_ROW_SIZE; block != 0; )
+            {
+                block -= FLASH_WRITE_SIZE;
+                BootSetTablePointer(address + block);
+                for (uint8_t i = 0; i < FLASH_WRITE_SIZE; i++)
+                {
+                    TABLAT = src[block + i];
+                    if (i != FLASH_WRITE_SIZE - 1)
+                        asm("TBLWT*+");
+                    else
+                        asm("TBLWT*");
+                }
+                BootUnlockAndWrite();
+            }
+            WREN = 0;
+
+            BootSetTablePointer(address);
+            for (uint8_t i = 0; i < BOOT_ROW_SIZE; i++)
+            {
+                asm("TBLRD*+");
+                if (TABLAT != src[i])
+                    exception = BOOT_EXC_EXECUTE;
+            }
+            // Entry row that failed verification must not start
+            if (exception != 0 && address == BOOT_APP_START)
+                BootEraseRow(BOOT_APP_START);
+        }
+        EEPGD = 0;
+
+        // Answer is echo of request
+        if (exception != 0)
+        {
+            frame[1] |= 0x80;
+            frame[2] = exception;
+            len = 5;
+            reset = false;
+        }
+        crc = 0xFFFF;
+        for (uint8_t i = 0; i < len - 2; i++)
+            BootCrcByte(crc, frame[i]);
+        frame[len - 2] = (uint8_t)crc;
+        frame[len - 1] = (uint8_t)(crc >> 8);
+        LATCbits.LATC5 = 1;
+        __delay_us(BOOT_TXE_DELAY);
+        for (uint8_t i = 0; i < len; i++)
+        {
+            while (!TRMT)
+                continue;
+            TXREG = frame[i];
+        }
+        while (!TRMT)
+            continue;
+        LATCbits.LATC5 = 0;
+
+        if (reset)
+            asm("RESET");
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef BOOT_H
+#define	BOOT_H
+
+// Field firmware update. Boot block at BOOT_START is not part of the
+// application image. Row 0 belongs to boot block and is never erased in
+// field: reset vector goes to BootReset, interrupt vectors go to the ones
+// of application. Application is linked with --codeoffset=BOOT_APP_START,
+// its image (BOOT_APP_START - FLASH_STORAGE_START) is sent by master with
+// FC21 to file MB_FILE_FIRMWARE, one 64-byte row per record.
+//
+// BootReset starts application only when its entry row (BOOT_APP_ROW,
+// reset and interrupt vectors) is programmed. Entry row is erased before
+// any other row is written and its new data is kept in RAM. It is written
+// only after CRC of whole image is verified, 8-byte blocks from the last
+// one, so reset vector is written last. That is the switch-over: after
+// power loss at any point device starts in boot block or in complete new
+// application.
+//
+// Update: FC100 MB_COMMAND_FIRMWARE_UPDATE with data BOOT_ENTER_KEY,
+// FC21 records (row number from BOOT_APP_ROW, 32 words), up to
+// BOOT_ROWS_PER_FRAME in one frame, then record BOOT_FINISH_RECORD with
+// 2 words: rows count (from row 0) and Modbus CRC16 of rows BOOT_APP_ROW
+// up to rows count.
+
+// Whole 0x6000-0x7FFF is excluded from the linker (--rom), so no
+// application code is placed beside boot block and left stale by update
+#define BOOT_START 0x7800u          // BootReset, up to 0x7DBB, debugger uses the rest
+#define BOOT_MAIN (BOOT_START + 0x40u) // BootMain, linker fails if BootReset overlaps
+#define BOOT_APP_START 0x0040u      // --codeoffset, row 0 holds boot vectors
+#define BOOT_ROW_SIZE 64            // Erase block
+#define BOOT_ROW_WORDS (BOOT_ROW_SIZE / 2)
+#define BOOT_IMAGE_ROWS (FLASH_STORAGE_START / BOOT_ROW_SIZE)
+#define BOOT_APP_ROW (BOOT_APP_START / BOOT_ROW_SIZE)
+// Frame and new entry row must fit in application frame slots, see BootMain
+#define BOOT_ROWS_PER_FRAME 2
+// FC21 header, 7 bytes sub-request header per row, CRC
+#define BOOT_FRAME_SIZE (3 + BOOT_ROWS_PER_FRAME * (7 + BOOT_ROW_SIZE) + 2)
+#define BOOT_FINISH_RECORD 0xFFFF
+
+#define BOOT_ENTER_KEY 0xB0
+#define BOOT_EE_ID 0x00             // Slave id for boot block, EEPROM byte
+
+// Application side: keep slave id for boot block and jump there
+void BootEnter(uint8_t slaveId);
+// Reset vector target, starts application or boot block
+void BootReset(void);
+// Boot block, never returns
+void BootMain(void);
+
+#endif	/* BOOT_H */
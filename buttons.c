@@ -0,0 +1,135 @@
+/******************************************************************************/
+/*Files to Include                                                            */
+/******************************************************************************/
+
+#if defined(__XC)
+    #include <xc.h>         /* XC8 General Include File */
+#elif defined(HI_TECH_C)
+    #include <htc.h>        /* HiTech General Include File */
+#elif defined(__18CXX)
+    #include <p18cxxx.h>    /* C18 General Include File */
+#endif
+
+#if defined(__XC) || defined(HI_TECH_C)
+
+#include <stdint.h>         /* For uint8_t definition */
+#include <stdbool.h>        /* For true/false definition */
+
+#endif
+
+#include "system.h"
+#include "buttons.h"
+
+#define LONG_PRESS_SCANS (BUTTON_LONG_PRESS_MS / BUTTONS_SCAN_MS)
+#define DOUBLE_GAP_SCANS (BUTTON_DOUBLE_GAP_MS / BUTTONS_SCAN_MS)
+
+static volatile bool _latchPhase = false;
+// Vertical counter, bit per button: count of samples differing from state
+static uint8_t _count0 = 0;
+static uint8_t _count1 = 0;
+static volatile uint8_t _state = 0;
+
+// Scans since press or release, saturated
+static uint8_t _scans[BUTTONS_COUNT];
+// Short press waits for possible second one
+static bool _pendingShort[BUTTONS_COUNT];
+// Press already reported as long or double, nothing on release
+static bool _reported[BUTTONS_COUNT];
+
+// Written only by interrupt
+static volatile uint8_t _eventsHead = 0;
+// Written only by main loop
+static volatile uint8_t _eventsTail = 0;
+static uint8_t _events[BUTTON_EVENTS_LEN];
+
+static void ButtonEventPut(uint8_t button, uint8_t kind)
+{
+    uint8_t head = _eventsHead;
+    if((uint8_t)(head - _eventsTail) >= BUTTON_EVENTS_LEN)
+        return; // full, main loop is stuck, drop new one
+    _events[head & (BUTTON_EVENTS_LEN - 1)] = (button << 4) | kind;
+    _eventsHead = head + 1;
+}
+
+static uint8_t ButtonsSample()
+{
+    uint8_t sample = 0;
+    if(!BUTTON_RESET_PIN) // pressed - low
+        sample |= 1 << BUTTON_RESET;
+    if(!BUTTON_INTRUSION_PIN)
+        sample |= 1 << BUTTON_INTRUSION;
+    return sample;
+}
+
+void ButtonsScan()
+{
+    uint8_t changed = 0;
+    if(!_latchPhase)
+    {
+        uint8_t delta = ButtonsSample() ^ _state;
+        // 2 bit counters, reset where sample equals state
+        _count1 = (_count1 ^ _count0) & delta;
+        _count0 = ~_count0 & delta;
+        changed = delta & ~(_count0 | _count1);
+        _state ^= changed;
+    }
+
+    for(uint8_t i = 0; i < BUTTONS_COUNT; i++)
+    {
+        bool pressed = (_state >> i) & 1;
+        if((changed >> i) & 1)
+        {
+            if(pressed)
+            {
+                _reported[i] = _pendingShort[i];
+                if(_pendingShort[i])
+                    ButtonEventPut(i, BUTTON_EVENT_DOUBLE);
+                _pendingShort[i] = false;
+            }
+            else if(!_reported[i])
+                _pendingShort[i] = true;
+            _scans[i] = 0;
+            continue;
+        }
+        if(_scans[i] != 0xFF)
+            _scans[i]++;
+        if(pressed)
+        {
+            if(!_reported[i] && _scans[i] == LONG_PRESS_SCANS)
+            {
+                _reported[i] = true;
+                ButtonEventPut(i, BUTTON_EVENT_LONG);
+            }
+        }
+        else if(_pendingShort[i] && _scans[i] == DOUBLE_GAP_SCANS)
+        {
+            _pendingShort[i] = false;
+            ButtonEventPut(i, BUTTON_EVENT_SHORT);
+        }
+    }
+}
+
+void ButtonsLatchBegin()
+{
+    _latchPhase = true;
+}
+
+void ButtonsLatchEnd()
+{
+    _latchPhase = false;
+}
+
+uint8_t ButtonsState()
+{
+    return _state;
+}
+
+bool ButtonTakeEvent(uint8_t *event)
+{
+    uint8_t tail = _eventsTail;
+    if(tail == _eventsHead)
+        return false;
+    *event = _events[tail & (BUTTON_EVENTS_LEN - 1)];
+    _eventsTail = tail + 1;
+    return true;
+}
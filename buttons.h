@@ -0,0 +1,39 @@
+#ifndef BUTTONS_H
+#define	BUTTONS_H
+
+// Inputs are sampled by high priority interrupt every BUTTONS_SCAN_MS and
+// debounced with vertical counter, state must be same for 4 samples.
+// RC1 and RC3 are also clocks of LED latches, samples are skipped while
+// UpdateLedRegister drives them (scan phase is when pins are inputs).
+
+#define BUTTON_RESET_PIN PORTCbits.RC1
+#define BUTTON_INTRUSION_PIN PORTCbits.RC3
+
+#define BUTTON_RESET 0
+#define BUTTON_INTRUSION 1
+#define BUTTONS_COUNT 2
+
+#define BUTTONS_SCAN_MS 10
+#define BUTTON_LONG_PRESS_MS 1000 // Held this long - long press
+#define BUTTON_DOUBLE_GAP_MS 300  // Second press within - double press
+
+#define BUTTON_EVENT_SHORT 0x01
+#define BUTTON_EVENT_LONG 0x02
+#define BUTTON_EVENT_DOUBLE 0x03
+
+#define BUTTON_EVENTS_LEN 8 // Power of 2
+// Event byte: HI nibble - button, LO nibble - event
+#define ButtonOf(event) ((event) >> 4)
+#define ButtonEventKind(event) ((event) & 0x0F)
+
+// Interrupt only
+void ButtonsScan();
+// LED latch clocks pulse on button pins, no sampling in between
+void ButtonsLatchBegin();
+void ButtonsLatchEnd();
+// Debounced state, bit per button, 1 - pressed
+uint8_t ButtonsState();
+// Return false when queue is empty
+bool ButtonTakeEvent(uint8_t *event);
+
+#endif	/* BUTTONS_H */
@@ -0,0 +1,49 @@
+/******************************************************************************/
+/*Files to Include                                                            */
+/******************************************************************************/
+
+#if defined(__XC)
+    #include <xc.h>         /* XC8 General Include File */
+#elif defined(HI_TECH_C)
+    #include <htc.h>        /* HiTech General Include File */
+#elif defined(__18CXX)
+    #include <p18cxxx.h>    /* C18 General Include File */
+#endif
+
+#if defined(__XC) || defined(HI_TECH_C)
+
+#include <stdint.h>         /* For uint8_t definition */
+#include <stdbool.h>        /* For true/false definition */
+
+#endif
+
+#include "system.h"
+#include "calendar.h"
+
+// Days before month in not leap year
+const uint16_t DaysBeforeMonth[12] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+
+// No loops, one 8x16 multiplication
+uint16_t DaysFromCivil(uint8_t year, uint8_t month, uint8_t day)
+{
+    if(month > 11)
+        month = 11;
+    // 2000 is leap, so leap years before this one - (year + 3) / 4
+    uint16_t days = (uint16_t)year * 365 + ((uint8_t)(year + 3) >> 2);
+    days += DaysBeforeMonth[month] + day - 1;
+    if(month > 1 && (year & 0x03) == 0)
+        days++;
+    return days;
+}
+
+uint8_t DayOfWeek(uint16_t days)
+{
+    // 01.01.2000 - Saturday
+    return (days + 5) % 7;
+}
+
+time_t CalendarToTime(uint16_t days, uint8_t hour, uint8_t minute, uint8_t second)
+{
+    uint32_t minutes = (uint32_t)(days + DAYS_1970_TO_2000) * 1440 + (uint16_t)hour * 60 + minute;
+    return minutes * 60 + second;
+}
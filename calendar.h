@@ -0,0 +1,19 @@
+#ifndef CALENDAR_H
+#define	CALENDAR_H
+
+#include <time.h>
+
+// Integer calendar for years 2000..2099, no libc mktime.
+// Days are counted from 01.01.2000 (Saturday).
+
+#define DATE_NOT_SET 0xFFFF
+#define DAYS_1970_TO_2000 10957u
+
+// year 0..99 (2000..2099), month 0..11, day 1..31
+uint16_t DaysFromCivil(uint8_t year, uint8_t month, uint8_t day);
+// 0 - Monday .. 6 - Sunday
+uint8_t DayOfWeek(uint16_t days);
+// Seconds from 01.01.1970, same as mktime
+time_t CalendarToTime(uint16_t days, uint8_t hour, uint8_t minute, uint8_t second);
+
+#endif	/* CALENDAR_H */
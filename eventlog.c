@@ -0,0 +1,81 @@
+/******************************************************************************/
+/*Files to Include                                                            */
+/******************************************************************************/
+
+#if defined(__XC)
+    #include <xc.h>         /* XC8 General Include File */
+#elif defined(HI_TECH_C)
+    #include <htc.h>        /* HiTech General Include File */
+#elif defined(__18CXX)
+    #include <p18cxxx.h>    /* C18 General Include File */
+#endif
+
+#if defined(__XC) || defined(HI_TECH_C)
+
+#include <stdint.h>         /* For uint8_t definition */
+#include <stdbool.h>        /* For true/false definition */
+
+#endif
+
+#include "system.h"
+#include "eventlog.h"
+
+typedef struct
+{
+    uint8_t Type;
+    uint8_t Data;
+    time_t Time;
+} EventLogRecord;
+
+EventLogRecord _eventLog[EVENT_LOG_LEN];
+uint8_t _eventLogTail = 0; // Oldest record
+uint8_t _eventLogCount = 0;
+uint16_t _eventLogFirstSeq = 0;
+
+static uint8_t EventLogIndex(uint8_t index)
+{
+    index += _eventLogTail;
+    if(index >= EVENT_LOG_LEN)
+        index -= EVENT_LOG_LEN;
+    return index;
+}
+
+static void EventLogDrop(uint8_t count)
+{
+    _eventLogTail = EventLogIndex(count);
+    _eventLogCount -= count;
+    _eventLogFirstSeq += count;
+}
+
+void EventLogAdd(uint8_t type, uint8_t data, time_t time)
+{
+    if(_eventLogCount == EVENT_LOG_LEN)
+        EventLogDrop(1);
+    EventLogRecord *record = &_eventLog[EventLogIndex(_eventLogCount)];
+    record->Type = type;
+    record->Data = data;
+    record->Time = time;
+    _eventLogCount++;
+}
+
+uint8_t EventLogAck(uint16_t seq)
+{
+    uint16_t acked = seq - _eventLogFirstSeq;
+    // Pointer outside of ring - master starts from the oldest record
+    if(acked <= _eventLogCount)
+        EventLogDrop((uint8_t)acked);
+    return _eventLogCount;
+}
+
+uint16_t EventLogFirstSeq()
+{
+    return _eventLogFirstSeq;
+}
+
+void EventLogGet(uint8_t index, uint8_t *type, uint8_t *data, time_t *time)
+{
+    EventLogRecord *record = &_eventLog[EventLogIndex(index)];
+    *type = record->Type;
+    *data = record->Data;
+    *time = record->Time;
+}
@@ -0,0 +1,33 @@
+#ifndef EVENTLOG_H
+#define	EVENTLOG_H
+
+#include <time.h>
+
+// RAM ring of timestamped device events, read by master with FC24.
+// Every record gets 16-bit sequence number. Master passes next sequence
+// number it expects as FIFO pointer, older records are dropped then.
+// When ring is full the oldest record is overwritten, master sees the gap
+// in sequence numbers.
+
+#define EVENT_LOG_LEN 16
+#define EVENT_LOG_RECORD_REGS 3 // HI - type, LO - data | time HI | time LO
+#define EVENT_LOG_READ_MAX 10   // Records in one FC24 answer, 31 registers max
+
+#define EVENT_LOG_BUTTON_PRESS 0x01      // Data - BUTTON_EVENT_*, reset button pressed
+#define EVENT_LOG_DIARY_FIRED 0x02       // Data - event number
+#define EVENT_LOG_DIARY_RESET 0x03       // Data - event number, reset by button
+#define EVENT_LOG_DIARY_TIMEOUT 0x04     // Data - event number, accept time passed
+#define EVENT_LOG_COMMAND_LED_FIRED 0x05 // Data - led number
+#define EVENT_LOG_COMMAND_LED_RESET 0x06 // Data - led number, reset by button
+#define EVENT_LOG_COMMAND_LED_TIMEOUT 0x07 // Data - led number, blink time passed
+#define EVENT_LOG_INTRUSION 0x08         // Data - BUTTON_EVENT_*, intrusion input
+
+void EventLogAdd(uint8_t type, uint8_t data, time_t time);
+// Drop records before seq if they are in ring. Return records count left
+uint8_t EventLogAck(uint16_t seq);
+// Sequence number of the oldest record
+uint16_t EventLogFirstSeq();
+// Record by index from the oldest one
+void EventLogGet(uint8_t index, uint8_t *type, uint8_t *data, time_t *time);
+
+#endif	/* EVENTLOG_H */
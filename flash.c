@@ -0,0 +1,112 @@
+/******************************************************************************/
+/*Files to Include                                                            */
+/******************************************************************************/
+
+#if defined(__XC)
+    #include <xc.h>         /* XC8 General Include File */
+#elif defined(HI_TECH_C)
+    #include <htc.h>        /* HiTech General Include File */
+#elif defined(__18CXX)
+    #include <p18cxxx.h>    /* C18 General Include File */
+#endif
+
+#if defined(__XC) || defined(HI_TECH_C)
+
+#include <stdint.h>         /* For uint8_t definition */
+#include <stdbool.h>        /* For true/false definition */
+
+#endif
+
+#include "system.h"
+#include "flash.h"
+
+static void SetTablePointer(uint16_t address)
+{
+    TBLPTRU = 0;
+    TBLPTRH = (uint8_t)(address >> 8);
+    TBLPTRL = (uint8_t)address;
+}
+
+static uint16_t BlockAddress(uint8_t blockNum)
+{
+    return FLASH_STORAGE_START + (uint16_t)blockNum * FLASH_BLOCK_SIZE;
+}
+
+uint8_t FlashReadRaw(uint8_t blockNum, uint8_t pos)
+{
+    SetTablePointer(BlockAddress(blockNum) + pos);
+    asm("TBLRD*");
+    return TABLAT;
+}
+
+uint8_t FlashRead(uint16_t offset)
+{
+    uint8_t blockNum = 0;
+    // Not divide, it is slow on PIC18
+    while (offset >= FLASH_BLOCK_PAYLOAD)
+    {
+        offset -= FLASH_BLOCK_PAYLOAD;
+        blockNum++;
+    }
+    return FlashReadRaw(blockNum, (uint8_t)offset);
+}
+
+uint16_t FlashEraseCount(uint8_t blockNum)
+{
+    uint16_t count = FlashReadRaw(blockNum, FLASH_BLOCK_PAYLOAD + 1);
+    count = (count << 8) | FlashReadRaw(blockNum, FLASH_BLOCK_PAYLOAD);
+    // Never written block is 0xFFFF
+    if (count == 0xFFFF)
+        count = 0;
+    return count;
+}
+
+// Unlock sequence for erase and write. CPU stalls until operation ends.
+static void FlashUnlockAndWrite()
+{
+    bool gieWasSet = GIE;
+    EEPGD = 1;
+    CFGS = 0;
+    WREN = 1;
+    GIE = 0;
+    EECON2 = 0x55;
+    EECON2 = 0xAA;
+    WR = 1;
+    asm("NOP");
+    if (gieWasSet)
+        GIE = 1;
+    WREN = 0;
+}
+
+uint16_t FlashWriteBlock(uint8_t blockNum, uint8_t *data)
+{
+    uint16_t address = BlockAddress(blockNum);
+    uint16_t eraseCount = FlashEraseCount(blockNum);
+    if (eraseCount < FLASH_ERASE_COUNT_MAX)
+        eraseCount++;
+
+    while (WR)
+        continue;
+
+    SetTablePointer(address);
+    FREE = 1;
+    FlashUnlockAndWrite();
+    FREE = 0;
+
+    // Pre-increment write keeps TBLPTR inside 8-byte block when WR set
+    SetTablePointer(address - 1);
+    for (uint8_t i = 0; i < FLASH_BLOCK_SIZE; i++)
+    {
+        if (i < FLASH_BLOCK_PAYLOAD)
+            TABLAT = data[i];
+        else if (i == FLASH_BLOCK_PAYLOAD)
+            TABLAT = (uint8_t)eraseCount;
+        else
+            TABLAT = (uint8_t)(eraseCount >> 8);
+        asm("TBLWT+*");
+        if ((i & (FLASH_WRITE_SIZE - 1)) == FLASH_WRITE_SIZE - 1)
+            FlashUnlockAndWrite();
+    }
+    EEPGD = 0;
+    return eraseCount;
+}
@@ -0,0 +1,35 @@
+#ifndef FLASH_H
+#define	FLASH_H
+
+// Program flash storage for large event tables and sound banks.
+// Region 0x6000-0x77FF is excluded from the linker (--rom, together with
+// boot block up to 0x7FFF) and split
+// into 64-byte erase blocks. Each block holds 62 data bytes and a 2-byte
+// erase counter (LO, HI) used to track wear.
+
+#define FLASH_STORAGE_START 0x6000u
+#define FLASH_BLOCK_SIZE 64         // Erase block
+#define FLASH_WRITE_SIZE 8          // Table write holding registers
+#define FLASH_BLOCK_PAYLOAD 62      // Data bytes in block, rest - erase counter
+#define FLASH_BLOCKS_COUNT 96
+// Event and sound bank, the rest is staging of config upload. Format
+// change: banks used to take all 96 blocks, LoadSoundTable rejects banks
+// with sounds past FLASH_BANK_BLOCKS
+#define FLASH_BANK_BLOCKS 92
+#define FLASH_STORAGE_SIZE (FLASH_BANK_BLOCKS * FLASH_BLOCK_PAYLOAD)
+#define FLASH_STAGING_FIRST_BLOCK FLASH_BANK_BLOCKS
+#define FLASH_STAGING_BLOCKS (FLASH_BLOCKS_COUNT - FLASH_BANK_BLOCKS)
+#define FLASH_STAGING_OFFSET FLASH_STORAGE_SIZE // FlashRead offset
+
+#define FLASH_ERASE_COUNT_MAX 0xFFFE
+
+// Read data byte. Offset skips erase counters (0 .. FLASH_STORAGE_SIZE - 1)
+uint8_t FlashRead(uint16_t offset);
+// Read raw byte of block (0 .. FLASH_BLOCK_SIZE - 1) including erase counter
+uint8_t FlashReadRaw(uint8_t blockNum, uint8_t pos);
+// How many times block was erased
+uint16_t FlashEraseCount(uint8_t blockNum);
+// Erase block and write FLASH_BLOCK_PAYLOAD bytes. Return erase count
+uint16_t FlashWriteBlock(uint8_t blockNum, uint8_t *data);
+
+#endif	/* FLASH_H */
@@ -0,0 +1,265 @@
+#include "master.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+namespace c2000bi {
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+constexpr milliseconds Master::kDefaultTimeout;
+constexpr milliseconds Master::kBroadcastTurnaround;
+
+Master::Master()
+    : _epoll(epoll_create1(EPOLL_CLOEXEC))
+{
+    if (_epoll < 0)
+        throw std::system_error(errno, std::generic_category(), "c2000bi: epoll_create1");
+}
+
+Master::~Master()
+{
+    close(_epoll);
+}
+
+int Master::AddBus(int fd, unsigned baud)
+{
+    if (baud == 0)
+        throw std::invalid_argument("c2000bi: baud rate");
+    Bus bus;
+    bus.fd = fd;
+    // 11 bit character, fixed 1.75 ms gap above 19200 as Modbus RTU says
+    bus.charTime = microseconds(11000000 / baud);
+    bus.t35 = baud > 19200 ? microseconds(1750) : microseconds(38500000 / baud);
+
+    int id = static_cast<int>(_buses.size());
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u32 = static_cast<uint32_t>(id);
+    if (epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &ev) != 0)
+        throw std::system_error(errno, std::generic_category(), "c2000bi: epoll_ctl");
+    _buses.push_back(std::move(bus));
+    return id;
+}
+
+void Master::Submit(int bus, Frame request, Callback done, milliseconds timeout)
+{
+    if (bus < 0 || static_cast<size_t>(bus) >= _buses.size())
+        throw std::out_of_range("c2000bi: no such bus");
+    Bus &b = _buses[bus];
+    if (b.failed) {
+        Result result;
+        result.status = Status::IoError;
+        _completed.push_back(Completion{std::move(done), std::move(result)});
+        return;
+    }
+    b.queue.push_back(Request{std::move(request), std::move(done), timeout});
+    Start(bus, b, Clock::now());
+}
+
+size_t Master::Pending() const
+{
+    size_t pending = 0;
+    for (const Bus &b : _buses)
+        pending += b.queue.size();
+    return pending;
+}
+
+int Master::Poll(int timeoutMs)
+{
+    Clock::time_point now = Clock::now();
+    for (size_t i = 0; i < _buses.size(); i++)
+        Start(static_cast<int>(i), _buses[i], now);
+
+    int wait = NextTimerMs(now);
+    if (_completed.size())
+        wait = 0;
+    else if (wait < 0 || (timeoutMs >= 0 && timeoutMs < wait))
+        wait = timeoutMs;
+
+    epoll_event events[16];
+    int n = epoll_wait(_epoll, events, 16, wait);
+    if (n < 0 && errno != EINTR)
+        throw std::system_error(errno, std::generic_category(), "c2000bi: epoll_wait");
+
+    now = Clock::now();
+    for (int i = 0; i < n; i++) {
+        int id = static_cast<int>(events[i].data.u32);
+        Bus &bus = _buses[id];
+        if (bus.failed)
+            continue;
+        if (events[i].events & EPOLLIN)
+            Receive(bus, now);
+        if ((events[i].events & EPOLLOUT) && bus.phase == Phase::Writing)
+            Send(id, bus, now);
+        if (events[i].events & (EPOLLERR | EPOLLHUP))
+            Fail(bus);
+    }
+
+    for (size_t i = 0; i < _buses.size(); i++) {
+        Bus &bus = _buses[i];
+        if (bus.phase == Phase::Waiting && now >= bus.deadline) {
+            Result result;
+            result.status = Status::Timeout;
+            Finish(bus, std::move(result), now);
+        }
+        Start(static_cast<int>(i), bus, now);
+    }
+
+    std::vector<Completion> completed;
+    completed.swap(_completed);
+    for (Completion &c : completed)
+        if (c.done)
+            c.done(c.result);
+    return static_cast<int>(completed.size());
+}
+
+void Master::Start(int id, Bus &bus, Clock::time_point now)
+{
+    if (bus.failed || bus.phase != Phase::Idle || bus.queue.empty() || now < bus.quietUntil)
+        return;
+
+    // Late answer to timed out request or line noise must not be taken
+    // as the answer of this one
+    uint8_t stale[64];
+    ssize_t got;
+    while ((got = read(bus.fd, stale, sizeof(stale))) > 0)
+        ;
+    if (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EIO) {
+        Fail(bus);
+        return;
+    }
+
+    bus.rx.clear();
+    bus.written = 0;
+    bus.phase = Phase::Writing;
+    Send(id, bus, now);
+}
+
+void Master::Send(int id, Bus &bus, Clock::time_point now)
+{
+    Request &req = bus.queue.front();
+    const std::vector<uint8_t> &bytes = req.frame.bytes;
+    while (bus.written < bytes.size()) {
+        ssize_t n = write(bus.fd, bytes.data() + bus.written, bytes.size() - bus.written);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                WatchOutput(id, bus, true);
+            else
+                Fail(bus);
+            return;
+        }
+        bus.written += static_cast<size_t>(n);
+    }
+    if (!WatchOutput(id, bus, false))
+        return;
+
+    // Frame is still on the wire when write returns
+    Clock::duration wire = bus.charTime * static_cast<int>(bytes.size());
+    if (req.frame.Slave() == kBroadcast) {
+        Finish(bus, Result{}, now);
+        bus.quietUntil = now + wire + kBroadcastTurnaround;
+        return;
+    }
+    bus.phase = Phase::Waiting;
+    bus.deadline = now + wire + req.timeout;
+}
+
+void Master::Receive(Bus &bus, Clock::time_point now)
+{
+    uint8_t buf[256];
+    ssize_t n;
+    while ((n = read(bus.fd, buf, sizeof(buf))) > 0) {
+        if (bus.phase == Phase::Waiting)
+            bus.rx.insert(bus.rx.end(), buf, buf + n);
+    }
+    if (bus.phase != Phase::Waiting)
+        return;
+
+    const Frame &request = bus.queue.front().frame;
+    size_t expected = ExpectedReplyLength(request, bus.rx.data(), bus.rx.size());
+    Result result;
+    if (expected && bus.rx.size() >= expected) {
+        result.reply.assign(bus.rx.begin(), bus.rx.begin() + expected);
+        if (!ReplyValid(request, result.reply))
+            result.status = Status::BadFrame;
+        else if ((result.exception = ReplyException(result.reply)) != 0)
+            result.status = Status::Exception;
+    } else if (bus.rx.size() > kMaxFrame
+               || (bus.rx.size() >= 2 && (bus.rx[0] != request.Slave() || (bus.rx[1] & 0x7F) != request.Function()))) {
+        result.reply = bus.rx;
+        result.status = Status::BadFrame;
+    } else {
+        return;
+    }
+    Finish(bus, std::move(result), now);
+}
+
+void Master::Finish(Bus &bus, Result result, Clock::time_point now)
+{
+    _completed.push_back(Completion{std::move(bus.queue.front().done), std::move(result)});
+    bus.queue.pop_front();
+    bus.phase = Phase::Idle;
+    bus.rx.clear();
+    bus.quietUntil = now + bus.t35;
+}
+
+void Master::Fail(Bus &bus)
+{
+    if (bus.failed)
+        return;
+    bus.failed = true;
+    epoll_ctl(_epoll, EPOLL_CTL_DEL, bus.fd, nullptr);
+    for (Request &req : bus.queue) {
+        Result result;
+        result.status = Status::IoError;
+        _completed.push_back(Completion{std::move(req.done), std::move(result)});
+    }
+    bus.queue.clear();
+    bus.phase = Phase::Idle;
+}
+
+bool Master::WatchOutput(int id, Bus &bus, bool on)
+{
+    if (bus.watchOutput == on)
+        return true;
+    epoll_event ev{};
+    ev.events = on ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    ev.data.u32 = static_cast<uint32_t>(id);
+    if (epoll_ctl(_epoll, EPOLL_CTL_MOD, bus.fd, &ev) != 0) {
+        Fail(bus);
+        return false;
+    }
+    bus.watchOutput = on;
+    return true;
+}
+
+int Master::NextTimerMs(Clock::time_point now) const
+{
+    Clock::time_point next = Clock::time_point::max();
+    for (const Bus &bus : _buses) {
+        if (bus.failed)
+            continue;
+        if (bus.phase == Phase::Waiting)
+            next = std::min(next, bus.deadline);
+        else if (bus.phase == Phase::Idle && !bus.queue.empty())
+            next = std::min(next, bus.quietUntil);
+    }
+    if (next == Clock::time_point::max())
+        return -1;
+    if (next <= now)
+        return 0;
+    // Round up, do not wake before the timer
+    return static_cast<int>(duration_cast<milliseconds>(next - now + milliseconds(1) - Clock::duration(1)).count());
+}
+
+} // namespace c2000bi
@@ -0,0 +1,103 @@
+// Modbus RTU master for C2000-BI panels. One request in flight per bus,
+// buses run side by side on one epoll loop. Single threaded, callbacks are
+// called from Poll() and may Submit() further requests.
+
+#ifndef C2000BI_MASTER_H
+#define C2000BI_MASTER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "protocol.h"
+
+namespace c2000bi {
+
+class Master {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Status {
+        Ok,
+        Timeout,
+        Exception, // Device answered with exception, see Result::exception
+        BadFrame,  // CRC, slave or function mismatch
+        IoError,   // Bus is failed, all its requests end so
+    };
+
+    struct Result {
+        Status status = Status::Ok;
+        uint8_t exception = 0;
+        std::vector<uint8_t> reply; // Whole frame with CRC, empty for broadcast
+    };
+
+    using Callback = std::function<void(const Result &)>;
+
+    static constexpr std::chrono::milliseconds kDefaultTimeout{500};
+    // Broadcast has no answer, slaves need time to act on it
+    static constexpr std::chrono::milliseconds kBroadcastTurnaround{100};
+
+    Master();
+    ~Master();
+    Master(const Master &) = delete;
+    Master &operator=(const Master &) = delete;
+
+    // fd must be non-blocking, it is not closed by Master. Returns bus id
+    int AddBus(int fd, unsigned baud);
+    void Submit(int bus, Frame request, Callback done,
+                std::chrono::milliseconds timeout = kDefaultTimeout);
+    // Waits up to timeoutMs (-1 - forever) for bus activity, runs callbacks.
+    // Returns number of completed requests
+    int Poll(int timeoutMs);
+    // Requests queued or in flight on all buses
+    size_t Pending() const;
+    // epoll fd, to nest Master into another event loop
+    int Fd() const { return _epoll; }
+
+private:
+    struct Request {
+        Frame frame;
+        Callback done;
+        std::chrono::milliseconds timeout;
+    };
+
+    enum class Phase { Idle, Writing, Waiting };
+
+    struct Bus {
+        int fd;
+        Clock::duration t35;
+        Clock::duration charTime;
+        std::deque<Request> queue;
+        Phase phase = Phase::Idle;
+        size_t written = 0;
+        std::vector<uint8_t> rx;
+        Clock::time_point deadline;
+        Clock::time_point quietUntil; // No send before, inter-frame gap
+        bool watchOutput = false;
+        bool failed = false;
+    };
+
+    struct Completion {
+        Callback done;
+        Result result;
+    };
+
+    void Start(int id, Bus &bus, Clock::time_point now);
+    void Send(int id, Bus &bus, Clock::time_point now);
+    void Receive(Bus &bus, Clock::time_point now);
+    void Finish(Bus &bus, Result result, Clock::time_point now);
+    void Fail(Bus &bus);
+    bool WatchOutput(int id, Bus &bus, bool on);
+    int NextTimerMs(Clock::time_point now) const;
+
+    int _epoll;
+    std::vector<Bus> _buses;
+    std::vector<Completion> _completed;
+};
+
+} // namespace c2000bi
+
+#endif // C2000BI_MASTER_H
@@ -0,0 +1,383 @@
+#include "protocol.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace c2000bi {
+
+namespace {
+
+constexpr uint8_t kCommandSetAddress = 0x01;
+constexpr uint8_t kCommandSetTime = 0x10;
+constexpr uint8_t kCommandConfigCommit = 0x20;
+constexpr uint8_t kCommandFirmwareUpdate = 0x7E;
+constexpr uint8_t kCommandReset = 0x7F;
+constexpr uint8_t kCommandClearAllEvents = 0x80;
+constexpr uint8_t kCommandSetLed = 0x82;
+constexpr uint8_t kCommandSetStatusLed = 0x83;
+constexpr uint8_t kCommandPlaySound = 0x91;
+constexpr uint8_t kCommandBatch = 0xA0;
+
+constexpr uint8_t kFileRefType = 6;
+constexpr size_t kCommandFrameLen = 12; // FC100/FC101 request and answer
+
+uint8_t Hi(uint16_t v) { return static_cast<uint8_t>(v >> 8); }
+uint8_t Lo(uint16_t v) { return static_cast<uint8_t>(v); }
+uint16_t Word(uint8_t hi, uint8_t lo) { return static_cast<uint16_t>(hi << 8 | lo); }
+
+Frame Finish(std::vector<uint8_t> bytes)
+{
+    uint16_t crc = Crc16(bytes.data(), bytes.size());
+    bytes.push_back(Lo(crc));
+    bytes.push_back(Hi(crc));
+    if (bytes.size() > kMaxFrame)
+        throw std::length_error("c2000bi: frame exceeds device buffer");
+    return Frame{std::move(bytes)};
+}
+
+Frame CommandFrame(uint8_t slave, uint8_t fc, const Command &c)
+{
+    return Finish({slave, fc, c.id, c.data, Hi(c.add1), Lo(c.add1),
+                   Hi(c.add2), Lo(c.add2), Hi(c.add3), Lo(c.add3)});
+}
+
+// Normal answer of at least min bytes
+bool HasBody(const std::vector<uint8_t> &reply, size_t min)
+{
+    return reply.size() >= min && ReplyException(reply) == 0;
+}
+
+} // namespace
+
+uint16_t Crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+    }
+    return crc;
+}
+
+Command Reset()
+{
+    return Command{kCommandReset};
+}
+
+Command SetAddress(uint8_t slaveId)
+{
+    return Command{kCommandSetAddress, slaveId};
+}
+
+Command SetTime(const std::tm &time)
+{
+    Command c{kCommandSetTime};
+    c.add1 = Word(static_cast<uint8_t>(time.tm_hour), static_cast<uint8_t>(time.tm_min));
+    c.add2 = Word(static_cast<uint8_t>(time.tm_mday), static_cast<uint8_t>(time.tm_sec));
+    c.add3 = Word(static_cast<uint8_t>(time.tm_mon), static_cast<uint8_t>(time.tm_year - 100));
+    return c;
+}
+
+Command ConfigCommit(uint8_t length, uint16_t crc)
+{
+    Command c{kCommandConfigCommit};
+    c.add1 = length;
+    c.add2 = crc;
+    return c;
+}
+
+Command FirmwareUpdate()
+{
+    return Command{kCommandFirmwareUpdate, kBootEnterKey};
+}
+
+Command ClearAllEvents()
+{
+    return Command{kCommandClearAllEvents};
+}
+
+Command SetLed(uint8_t led, LedColor color, bool blink, uint8_t soundId,
+               uint8_t playSeconds, uint8_t fireSeconds)
+{
+    Command c{kCommandSetLed};
+    c.data = static_cast<uint8_t>((color != kLedOff ? 0x80 : 0) | (blink ? 0x40 : 0) | (color & 0x03));
+    c.add1 = Word(soundId, playSeconds);
+    c.add2 = Word(led, fireSeconds);
+    return c;
+}
+
+Command SetStatusLed(StatusLed led, bool on, bool blink, uint8_t soundId, uint8_t playSeconds)
+{
+    Command c{kCommandSetStatusLed};
+    c.data = static_cast<uint8_t>((on ? 0x80 : 0) | (blink ? 0x40 : 0) | (led & 0x07));
+    c.add1 = Word(soundId, playSeconds);
+    return c;
+}
+
+Command PlaySound(uint8_t soundId, uint8_t priority, uint8_t playSeconds)
+{
+    Command c{kCommandPlaySound, soundId};
+    c.add1 = Word(priority, playSeconds);
+    return c;
+}
+
+// Same sizes as firmware ModbusRtu.h, checked by master_test
+size_t BatchedSize(uint8_t commandId)
+{
+    switch (commandId) {
+    case kCommandClearAllEvents:
+        return 2;
+    case kCommandSetLed:
+        return 6;
+    case kCommandSetStatusLed:
+    case kCommandPlaySound:
+        return 4;
+    }
+    return 0;
+}
+
+Frame ReadBits(uint8_t slave, FunctionCode fc, uint16_t start, uint16_t count)
+{
+    return Finish({slave, fc, Hi(start), Lo(start), Hi(count), Lo(count)});
+}
+
+Frame ReadRegisters(uint8_t slave, FunctionCode fc, uint16_t start, uint16_t count)
+{
+    return Finish({slave, fc, Hi(start), Lo(start), Hi(count), Lo(count)});
+}
+
+Frame WriteCoil(uint8_t slave, uint16_t coil, bool on)
+{
+    return Finish({slave, kWriteCoil, Hi(coil), Lo(coil), static_cast<uint8_t>(on ? 0xFF : 0x00), 0x00});
+}
+
+Frame WriteRegister(uint8_t slave, uint16_t reg, uint16_t value)
+{
+    return Finish({slave, kWriteRegister, Hi(reg), Lo(reg), Hi(value), Lo(value)});
+}
+
+Frame WriteRegisters(uint8_t slave, uint16_t start, const std::vector<uint16_t> &values)
+{
+    uint16_t count = static_cast<uint16_t>(values.size());
+    std::vector<uint8_t> bytes{slave, kWriteMultipleRegisters, Hi(start), Lo(start),
+                               Hi(count), Lo(count), static_cast<uint8_t>(count * 2)};
+    for (uint16_t v : values) {
+        bytes.push_back(Hi(v));
+        bytes.push_back(Lo(v));
+    }
+    return Finish(std::move(bytes));
+}
+
+Frame ReadEventLog(uint8_t slave, uint16_t nextSeq)
+{
+    return Finish({slave, kReadFifoQueue, Hi(nextSeq), Lo(nextSeq)});
+}
+
+Frame SystemCommand(uint8_t slave, const Command &command)
+{
+    return CommandFrame(slave, kSystemCommand, command);
+}
+
+Frame UserCommand(uint8_t slave, const Command &command)
+{
+    return CommandFrame(slave, kUserCommand, command);
+}
+
+Frame UserCommandBatch(uint8_t slave, const std::vector<Command> &commands)
+{
+    std::vector<uint8_t> bytes{slave, kUserCommand, kCommandBatch, static_cast<uint8_t>(commands.size())};
+    for (const Command &c : commands) {
+        size_t size = BatchedSize(c.id);
+        if (size == 0)
+            throw std::invalid_argument("c2000bi: command can not be batched");
+        const uint8_t packed[] = {c.id, c.data, Hi(c.add1), Lo(c.add1), Hi(c.add2), Lo(c.add2)};
+        bytes.insert(bytes.end(), packed, packed + size);
+    }
+    return Finish(std::move(bytes));
+}
+
+Frame ReadDeviceStatus(uint8_t slave)
+{
+    return Finish({slave, kReadDeviceStatus});
+}
+
+Frame ReadFileRecords(uint8_t slave, const std::vector<FileRecordRef> &refs)
+{
+    std::vector<uint8_t> bytes{slave, kReadFileRecord, static_cast<uint8_t>(refs.size() * 7)};
+    for (const FileRecordRef &r : refs) {
+        const uint8_t sub[] = {kFileRefType, 0, r.file, Hi(r.record), Lo(r.record), Hi(r.words), Lo(r.words)};
+        bytes.insert(bytes.end(), sub, sub + sizeof(sub));
+    }
+    return Finish(std::move(bytes));
+}
+
+Frame WriteFileRecord(uint8_t slave, uint8_t file, uint16_t record, const std::vector<uint8_t> &data)
+{
+    if (data.size() % 2 != 0)
+        throw std::invalid_argument("c2000bi: file record is not whole words");
+    uint16_t words = static_cast<uint16_t>(data.size() / 2);
+    std::vector<uint8_t> bytes{slave, kWriteFileRecord, static_cast<uint8_t>(7 + data.size()),
+                               kFileRefType, 0, file, Hi(record), Lo(record), Hi(words), Lo(words)};
+    bytes.insert(bytes.end(), data.begin(), data.end());
+    return Finish(std::move(bytes));
+}
+
+Frame WriteEeprom(uint8_t slave, uint8_t address, const std::vector<uint8_t> &data)
+{
+    if (address % 2 != 0)
+        throw std::invalid_argument("c2000bi: EEPROM record starts on word");
+    return WriteFileRecord(slave, kFileEeprom, address / 2, data);
+}
+
+Frame WriteFlashBlock(uint8_t slave, uint8_t block, const std::vector<uint8_t> &data)
+{
+    std::vector<uint8_t> payload(data);
+    payload.resize(kFlashBlockPayload, 0xFF);
+    return WriteFileRecord(slave, kFileFlash, block, payload);
+}
+
+std::vector<Frame> StageConfig(uint8_t slave, const std::vector<uint8_t> &image)
+{
+    if (image.empty() || image.size() > kEeSettingsJournal)
+        throw std::length_error("c2000bi: config image does not fit EEPROM");
+    std::vector<Frame> frames;
+    for (size_t offset = 0, block = 0; offset < image.size(); offset += kFlashBlockPayload, block++) {
+        size_t end = std::min(offset + kFlashBlockPayload, image.size());
+        std::vector<uint8_t> chunk(image.begin() + offset, image.begin() + end);
+        chunk.resize(kFlashBlockPayload, 0xFF);
+        frames.push_back(WriteFileRecord(slave, kFileConfigStage, static_cast<uint16_t>(block), chunk));
+    }
+    uint16_t crc = Crc16(image.data(), image.size());
+    frames.push_back(SystemCommand(slave, ConfigCommit(static_cast<uint8_t>(image.size()), crc)));
+    return frames;
+}
+
+std::vector<uint8_t> EncodeEventTable(const std::vector<DiaryEvent> &events, bool withDayMask)
+{
+    std::vector<uint8_t> bytes{static_cast<uint8_t>(events.size() | (withDayMask ? kEventsWithDayMask : 0))};
+    for (const DiaryEvent &e : events) {
+        bytes.push_back(static_cast<uint8_t>((e.duration & 0x07) << 5 | (e.hour & 0x1F)));
+        bytes.push_back(static_cast<uint8_t>((e.soundId & 0x03) << 6 | (e.minute & 0x3F)));
+        if (withDayMask)
+            bytes.push_back(e.dayMask);
+    }
+    return bytes;
+}
+
+size_t ExpectedReplyLength(const Frame &request, const uint8_t *reply, size_t len)
+{
+    if (len < 2)
+        return 0;
+    if (reply[1] & 0x80)
+        return 5;
+    switch (reply[1]) {
+    case kReadCoils:
+    case kReadDiscreteInputs:
+    case kReadHoldingRegisters:
+    case kReadInputRegisters:
+    case kReportSlaveId:
+    case kReadFileRecord:
+        return len < 3 ? 0 : 3 + reply[2] + 2;
+    case kWriteCoil:
+    case kWriteRegister:
+    case kWriteMultipleCoils:
+    case kWriteMultipleRegisters:
+        return 8;
+    case kReadExceptionStatus:
+    case kReadDeviceStatus:
+        return 5;
+    case kWriteFileRecord:
+        return request.bytes.size(); // echo
+    case kReadFifoQueue:
+        return len < 4 ? 0 : 4 + Word(reply[2], reply[3]) + 2;
+    case kSystemCommand:
+        return kCommandFrameLen;
+    case kUserCommand:
+        if (request.bytes.size() > 3 && request.bytes[2] == kCommandBatch)
+            return 4 + request.bytes[3] + 2;
+        return kCommandFrameLen;
+    }
+    return 0;
+}
+
+bool ReplyValid(const Frame &request, const std::vector<uint8_t> &reply)
+{
+    size_t n = reply.size();
+    if (n < 4 || reply[0] != request.Slave() || (reply[1] & 0x7F) != request.Function())
+        return false;
+    uint16_t crc = Crc16(reply.data(), n - 2);
+    return reply[n - 2] == Lo(crc) && reply[n - 1] == Hi(crc);
+}
+
+uint8_t ReplyException(const std::vector<uint8_t> &reply)
+{
+    if (reply.size() < 3 || !(reply[1] & 0x80))
+        return 0;
+    return reply[2];
+}
+
+std::vector<bool> ParseBits(const std::vector<uint8_t> &reply, uint16_t count)
+{
+    std::vector<bool> bits;
+    if (!HasBody(reply, 5) || reply[2] * 8u < count)
+        return bits;
+    for (uint16_t i = 0; i < count; i++)
+        bits.push_back((reply[3 + i / 8] >> (i % 8)) & 1);
+    return bits;
+}
+
+std::vector<uint16_t> ParseRegisters(const std::vector<uint8_t> &reply)
+{
+    std::vector<uint16_t> regs;
+    if (!HasBody(reply, 5))
+        return regs;
+    for (size_t i = 0; i + 1 < reply[2] && 4 + i < reply.size() - 2; i += 2)
+        regs.push_back(Word(reply[3 + i], reply[4 + i]));
+    return regs;
+}
+
+std::vector<uint8_t> ParseBatchStatus(const std::vector<uint8_t> &reply)
+{
+    if (!HasBody(reply, 6))
+        return {};
+    return std::vector<uint8_t>(reply.begin() + 4, reply.end() - 2);
+}
+
+uint8_t ParseDeviceStatus(const std::vector<uint8_t> &reply)
+{
+    return HasBody(reply, 5) ? reply[2] : 0;
+}
+
+std::vector<std::vector<uint8_t>> ParseFileRecords(const std::vector<uint8_t> &reply)
+{
+    std::vector<std::vector<uint8_t>> records;
+    if (!HasBody(reply, 5))
+        return records;
+    size_t end = std::min<size_t>(3 + reply[2], reply.size() - 2);
+    size_t pos = 3;
+    while (pos + 2 <= end) {
+        size_t len = reply[pos]; // reference type and data
+        if (len == 0 || pos + 1 + len > end)
+            break;
+        records.emplace_back(reply.begin() + pos + 2, reply.begin() + pos + 1 + len);
+        pos += 1 + len;
+    }
+    return records;
+}
+
+std::vector<LogRecord> ParseEventLog(const std::vector<uint8_t> &reply)
+{
+    std::vector<LogRecord> records;
+    if (!HasBody(reply, 10))
+        return records;
+    uint16_t seq = Word(reply[6], reply[7]);
+    for (size_t pos = 8; pos + 6 <= reply.size() - 2; pos += 6, seq++) {
+        uint32_t time = static_cast<uint32_t>(reply[pos + 2]) << 24 | static_cast<uint32_t>(reply[pos + 3]) << 16
+                | static_cast<uint32_t>(reply[pos + 4]) << 8 | reply[pos + 5];
+        records.push_back(LogRecord{seq, reply[pos], reply[pos + 1], time});
+    }
+    return records;
+}
+
+} // namespace c2000bi
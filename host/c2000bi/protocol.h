@@ -0,0 +1,241 @@
+// C2000-BI Modbus RTU protocol, host (master) side.
+// Constants mirror ModbusRtu.h, user.h register tables and main.c EEPROM
+// layout of the firmware. Builders return whole RTU frames with CRC,
+// parsers take whole reply frames.
+
+#ifndef C2000BI_PROTOCOL_H
+#define C2000BI_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <vector>
+
+namespace c2000bi {
+
+constexpr uint8_t kBroadcast = 0;
+constexpr uint8_t kDefaultSlaveId = 0x7F;
+constexpr size_t kMaxFrame = 140; // Firmware frame slot
+
+enum FunctionCode : uint8_t {
+    kReadCoils = 1,
+    kReadDiscreteInputs = 2,
+    kReadHoldingRegisters = 3,
+    kReadInputRegisters = 4,
+    kWriteCoil = 5,
+    kWriteRegister = 6,
+    kReadExceptionStatus = 7,
+    kWriteMultipleCoils = 15,
+    kWriteMultipleRegisters = 16,
+    kReportSlaveId = 17,
+    kReadFileRecord = 20,
+    kWriteFileRecord = 21,
+    kReadFifoQueue = 24,
+    kSystemCommand = 100,
+    kUserCommand = 101,
+    kReadDeviceStatus = 102,
+};
+
+enum ExceptionCode : uint8_t {
+    kIllegalFunction = 1,
+    kIllegalAddress = 2,
+    kIllegalValue = 3,
+    kDeviceFailure = 4,
+    kDeviceBusy = 6, // FC101 does not fit behind queued batch, retry later
+};
+
+// FC20/FC21 file numbers
+enum FileNumber : uint8_t {
+    kFileEeprom = 1,      // Record - EEPROM word address
+    kFileFlash = 2,       // Record - flash storage block, whole block writes
+    kFileFirmware = 3,    // Record - image row, boot block only
+    kFileConfigStage = 4, // Record - staging block for config commit
+};
+
+constexpr size_t kFlashBlockPayload = 62;
+constexpr size_t kFlashBlockSize = 64;  // With erase counter, FC20 only
+constexpr size_t kFlashBankBlocks = 92;
+constexpr size_t kConfigStageBlocks = 4;
+constexpr size_t kFirmwareRowSize = 64;
+constexpr size_t kFirmwareImageRows = 0x6000 / kFirmwareRowSize;
+// Row 0 holds boot vectors and is not sent. Image is linked at 0x40, finish
+// record has rows count from row 0 and CRC of rows kFirmwareFirstRow and up
+constexpr size_t kFirmwareFirstRow = 1;
+constexpr uint16_t kFirmwareFinishRecord = 0xFFFF;
+constexpr uint8_t kBootEnterKey = 0xB0;
+
+// EEPROM layout
+constexpr uint8_t kEeModbusId = 1;
+constexpr uint8_t kEeEventAcceptTime = 2;
+constexpr uint8_t kEeMaxEvents = 3;
+constexpr uint8_t kEeEventCount = 10; // 7 bit - events with day mask
+constexpr uint8_t kEeFirstEvent = 11;
+constexpr uint8_t kEeSettingsJournal = 0xD0; // Config image ends before
+constexpr uint8_t kEventsWithDayMask = 0x80;
+
+enum Coil : uint16_t {
+    kCoilFire = 0x00,
+    kCoilWarning = 0x01,
+    kCoilAlarm = 0x02,
+    kCoilAssault = 0x03,
+    kCoilNotResponse = 0x04,
+    kCoilBlocking = 0x05,
+    kCoilFault = 0x06,
+    kCoilWorking = 0x07,
+    kCoilClearAllEvents = 0x09,
+};
+
+enum InputRegister : uint16_t {
+    kInputChangeSeq = 0,
+    kInputCurrentHourMin = 1,
+    kInputEventOldCurNum = 2,
+    kInputEventHourMin = 3,
+    kInputCurrentHourMin2 = 4,
+    kInputSeconds = 5,
+    kInputSoundCountEventCount = 6,
+    kInputPlLenPosInEe = 7,
+    kInputTotalMinutes = 8,
+    kInputSoundPlaying = 9,
+    kInputSoundQueue = 10,
+    kInputDayOfWeek = 11,
+    kInputFlashWear = 12,
+    kInputWatchCorrection = 13,
+    kInputUartErrors = 14,
+    kInputButtons = 15,
+    kInputRegistersCount
+};
+
+enum HoldingRegister : uint16_t {
+    kHoldingEventAcceptTime = 4,
+    kHoldingBuzzerEscalade = 5,
+    kHoldingEveningMorningHour = 6,
+    kHoldingNightStartEndHour = 7,
+    kHoldingBlinkDurationPeriod = 8,
+    kHoldingReplayWindowMs = 9,
+    kHoldingRegistersEnd
+};
+
+// FC102 device status bits
+enum DeviceStatusBit : uint8_t {
+    kStatusTimeSet = 0,
+    kStatusNeedTimeSet = 1,
+};
+
+// FC101 batch answer, per sub-command
+enum BatchStatus : uint8_t {
+    kBatchQueued = 0,
+    kBatchUnknown = 1,
+    kBatchQueueFull = 2,
+};
+
+enum LedColor : uint8_t { kLedOff = 0, kLedGreen = 1, kLedRed = 2, kLedOrange = 3 };
+
+enum StatusLed : uint8_t {
+    kStatusFire = 0,
+    kStatusWarning = 1,
+    kStatusAlarm = 2,
+    kStatusAssault = 3,
+    kStatusNotResponse = 4,
+};
+
+// FC100 and FC101 command block: id, data, three additional words
+struct Command {
+    uint8_t id = 0;
+    uint8_t data = 0;
+    uint16_t add1 = 0;
+    uint16_t add2 = 0;
+    uint16_t add3 = 0;
+};
+
+// System commands (FC100)
+Command Reset();
+Command SetAddress(uint8_t slaveId);
+Command SetTime(const std::tm &time); // year 2000..2099
+Command ConfigCommit(uint8_t length, uint16_t crc);
+Command FirmwareUpdate();
+
+// User commands (FC101), match ProcessUserCommands of firmware
+Command ClearAllEvents();
+// fireSeconds > 0 - blinks orange like diary event until reset button or
+// timeout. soundId 0xFF - no sound
+Command SetLed(uint8_t led, LedColor color, bool blink, uint8_t soundId = 0xFF,
+               uint8_t playSeconds = 0, uint8_t fireSeconds = 0);
+Command SetStatusLed(StatusLed led, bool on, bool blink, uint8_t soundId = 0xFF,
+                     uint8_t playSeconds = 0);
+// priority 0 - info, panel caps it at 5 (warning), below alarm and fire
+Command PlaySound(uint8_t soundId, uint8_t priority = 0, uint8_t playSeconds = 0);
+// Bytes of command packed in FC101 batch, 0 - not batchable
+size_t BatchedSize(uint8_t commandId);
+
+uint16_t Crc16(const uint8_t *data, size_t len);
+
+// Request frame and how its answer is recognised
+struct Frame {
+    std::vector<uint8_t> bytes;
+    uint8_t Slave() const { return bytes.empty() ? 0 : bytes[0]; }
+    uint8_t Function() const { return bytes.size() < 2 ? 0 : bytes[1]; }
+};
+
+Frame ReadBits(uint8_t slave, FunctionCode fc, uint16_t start, uint16_t count);
+Frame ReadRegisters(uint8_t slave, FunctionCode fc, uint16_t start, uint16_t count);
+Frame WriteCoil(uint8_t slave, uint16_t coil, bool on);
+Frame WriteRegister(uint8_t slave, uint16_t reg, uint16_t value);
+Frame WriteRegisters(uint8_t slave, uint16_t start, const std::vector<uint16_t> &values);
+Frame ReadEventLog(uint8_t slave, uint16_t nextSeq);
+Frame SystemCommand(uint8_t slave, const Command &command);
+Frame UserCommand(uint8_t slave, const Command &command);
+Frame UserCommandBatch(uint8_t slave, const std::vector<Command> &commands);
+Frame ReadDeviceStatus(uint8_t slave);
+
+struct FileRecordRef {
+    uint8_t file;
+    uint16_t record;
+    uint16_t words;
+};
+Frame ReadFileRecords(uint8_t slave, const std::vector<FileRecordRef> &refs);
+// Data length must be even
+Frame WriteFileRecord(uint8_t slave, uint8_t file, uint16_t record, const std::vector<uint8_t> &data);
+Frame WriteEeprom(uint8_t slave, uint8_t address, const std::vector<uint8_t> &data);
+Frame WriteFlashBlock(uint8_t slave, uint8_t block, const std::vector<uint8_t> &data);
+
+// Staged config upload: file #4 blocks, then ConfigCommit command
+std::vector<Frame> StageConfig(uint8_t slave, const std::vector<uint8_t> &image);
+
+// EEPROM event record. duration: 0 - once, 1 - 10 s, 2 - 30 s, 3 - 1 min,
+// 4 - 5 min, 5 - 12 min, 6 - 30 min, 7 - infinite. dayMask bit 0 - Monday,
+// used only in tables with day mask
+struct DiaryEvent {
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t soundId;  // 0..3
+    uint8_t duration; // 0..7
+    uint8_t dayMask = 0x7F;
+};
+// Event count byte and records, starting from kEeEventCount
+std::vector<uint8_t> EncodeEventTable(const std::vector<DiaryEvent> &events, bool withDayMask);
+
+// Total reply length known from received bytes, 0 - need more bytes
+size_t ExpectedReplyLength(const Frame &request, const uint8_t *reply, size_t len);
+// Slave, function and CRC match the request
+bool ReplyValid(const Frame &request, const std::vector<uint8_t> &reply);
+// Exception code, 0 - normal answer
+uint8_t ReplyException(const std::vector<uint8_t> &reply);
+
+std::vector<bool> ParseBits(const std::vector<uint8_t> &reply, uint16_t count);
+std::vector<uint16_t> ParseRegisters(const std::vector<uint8_t> &reply);
+std::vector<uint8_t> ParseBatchStatus(const std::vector<uint8_t> &reply);
+uint8_t ParseDeviceStatus(const std::vector<uint8_t> &reply);
+// Record data of FC20 answer, in request order
+std::vector<std::vector<uint8_t>> ParseFileRecords(const std::vector<uint8_t> &reply);
+
+struct LogRecord {
+    uint16_t seq;
+    uint8_t type;
+    uint8_t data;
+    uint32_t time;
+};
+std::vector<LogRecord> ParseEventLog(const std::vector<uint8_t> &reply);
+
+} // namespace c2000bi
+
+#endif // C2000BI_PROTOCOL_H
@@ -0,0 +1,16 @@
+// Raw serial port for the panel bus.
+
+#ifndef C2000BI_SERIAL_H
+#define C2000BI_SERIAL_H
+
+#include <string>
+
+namespace c2000bi {
+
+// 8N1, no flow control, non-blocking. Works for tty and pty devices.
+// Returns fd, throws std::system_error
+int OpenSerial(const std::string &path, unsigned baud);
+
+} // namespace c2000bi
+
+#endif // C2000BI_SERIAL_H
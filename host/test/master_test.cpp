@@ -0,0 +1,501 @@
+// Master against host build of panel firmware (test/panel), one forked
+// panel per pty pair: make -C host test
+
+#include <fcntl.h>
+#include <pty.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+#include "c2000bi/master.h"
+#include "c2000bi/protocol.h"
+#include "panel/panel.h"
+
+using namespace c2000bi;
+using namespace std::chrono_literals;
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(cond)                                                                       \
+    do {                                                                                  \
+        if (!(cond)) {                                                                    \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                                   \
+        }                                                                                 \
+    } while (0)
+
+struct Panel {
+    pid_t pid;
+    int fd; // Master side of pty
+};
+
+std::vector<Panel> panels;
+
+Panel StartPanel()
+{
+    termios raw{};
+    cfmakeraw(&raw);
+    int master, slave;
+    if (openpty(&master, &slave, nullptr, &raw, nullptr) != 0) {
+        std::perror("openpty");
+        std::exit(1);
+    }
+    std::fflush(nullptr);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(master);
+        for (const Panel &p : panels)
+            close(p.fd);
+        PanelRun(slave);
+        _exit(0);
+    }
+    close(slave);
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    panels.push_back({pid, master});
+    return panels.back();
+}
+
+void StopPanels()
+{
+    for (const Panel &p : panels) {
+        close(p.fd);
+        int status;
+        if (waitpid(p.pid, &status, 0) != p.pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            CHECK(!"panel did not exit cleanly");
+    }
+    panels.clear();
+}
+
+Master::Result Call(Master &master, int bus, const Frame &frame,
+                    std::chrono::milliseconds timeout = Master::kDefaultTimeout)
+{
+    Master::Result result;
+    bool done = false;
+    master.Submit(bus, frame, [&](const Master::Result &r) { result = r; done = true; }, timeout);
+    while (!done)
+        master.Poll(100);
+    return result;
+}
+
+bool IsOk(const Master::Result &r) { return r.status == Master::Status::Ok; }
+
+bool IsException(const Master::Result &r, uint8_t code)
+{
+    return r.status == Master::Status::Exception && r.exception == code;
+}
+
+std::vector<uint16_t> InputRegs(Master &master, int bus, uint8_t slave)
+{
+    Master::Result r = Call(master, bus, ReadRegisters(slave, kReadInputRegisters, 0, PANEL_INPUT_REGS));
+    CHECK(IsOk(r));
+    std::vector<uint16_t> regs = ParseRegisters(r.reply);
+    regs.resize(PANEL_INPUT_REGS);
+    return regs;
+}
+
+// User commands run by panel: word(id, data), oldest first, last
+// PANEL_LOG_LEN at most. Waits until count commands were run
+std::vector<uint16_t> CommandLog(Master &master, int bus, uint8_t slave, uint16_t count)
+{
+    std::vector<uint16_t> regs = InputRegs(master, bus, slave);
+    for (int i = 0; i < 100 && regs[PANEL_REG_COMMANDS] < count; i++) {
+        std::this_thread::sleep_for(10ms);
+        regs = InputRegs(master, bus, slave);
+    }
+    CHECK(regs[PANEL_REG_COMMANDS] == count);
+    std::vector<uint16_t> log;
+    uint16_t n = regs[PANEL_REG_COMMANDS];
+    for (uint16_t k = n > PANEL_LOG_LEN ? n - PANEL_LOG_LEN : 0; k < n; k++)
+        log.push_back(regs[PANEL_REG_LOG + k % PANEL_LOG_LEN]);
+    return log;
+}
+
+uint16_t Logged(const Command &c) { return static_cast<uint16_t>(c.id << 8 | c.data); }
+
+std::tm TestTime(int hour, int minute)
+{
+    std::tm t{};
+    t.tm_year = 126;
+    t.tm_mon = 9;
+    t.tm_mday = 19;
+    t.tm_hour = hour;
+    t.tm_min = minute;
+    t.tm_sec = 20;
+    return t;
+}
+
+// Panel state: commands run so far and slave id, tests go in order
+struct Target {
+    int bus;
+    uint8_t slave;
+    uint16_t commands;
+};
+
+void TestDeviceStatus(Master &m, Target &t)
+{
+    Master::Result r = Call(m, t.bus, ReadDeviceStatus(t.slave));
+    CHECK(IsOk(r));
+    CHECK(r.reply.size() == 5);
+    uint8_t status = ParseDeviceStatus(r.reply);
+    CHECK(!(status & 1 << kStatusTimeSet));
+    CHECK(status & 1 << kStatusNeedTimeSet);
+}
+
+void TestSetTime(Master &m, Target &t)
+{
+    Frame f = SystemCommand(t.slave, SetTime(TestTime(14, 35)));
+    Master::Result r = Call(m, t.bus, f);
+    CHECK(IsOk(r));
+    CHECK(r.reply == f.bytes);
+    r = Call(m, t.bus, ReadDeviceStatus(t.slave));
+    CHECK(IsOk(r) && (ParseDeviceStatus(r.reply) & 1 << kStatusTimeSet));
+    CHECK(InputRegs(m, t.bus, t.slave)[PANEL_REG_TIME] == (14 << 8 | 35));
+
+    std::tm bad = TestTime(24, 0);
+    CHECK(IsException(Call(m, t.bus, SystemCommand(t.slave, SetTime(bad))), kIllegalValue));
+}
+
+void TestUserCommand(Master &m, Target &t)
+{
+    Command c = SetLed(3, kLedRed, false);
+    Frame f = UserCommand(t.slave, c);
+    Master::Result r = Call(m, t.bus, f);
+    CHECK(IsOk(r));
+    CHECK(r.reply.size() == 12);
+    t.commands++;
+    CHECK(CommandLog(m, t.bus, t.slave, t.commands).back() == Logged(c));
+}
+
+// Master packs sub-commands with sizes of firmware
+void TestBatchedSizes()
+{
+    for (unsigned id = 0; id <= 0xFF; id++)
+        CHECK(BatchedSize(static_cast<uint8_t>(id)) == UserCommandSize(static_cast<unsigned char>(id)));
+}
+
+void TestBatch(Master &m, Target &t)
+{
+    std::vector<Command> batch{SetLed(1, kLedGreen, true), PlaySound(2), SetStatusLed(kStatusFire, true, false)};
+    Master::Result r = Call(m, t.bus, UserCommandBatch(t.slave, batch));
+    CHECK(IsOk(r));
+    CHECK(ParseBatchStatus(r.reply) == std::vector<uint8_t>(batch.size(), kBatchQueued));
+    t.commands += batch.size();
+    std::vector<uint16_t> log = CommandLog(m, t.bus, t.slave, t.commands);
+    CHECK(std::vector<uint16_t>(log.end() - batch.size(), log.end())
+          == (std::vector<uint16_t>{Logged(batch[0]), Logged(batch[1]), Logged(batch[2])}));
+
+    // Not batchable command is reported, rest is queued
+    std::vector<uint8_t> bytes = UserCommandBatch(t.slave, {PlaySound(1)}).bytes;
+    bytes.resize(bytes.size() - 2);
+    bytes[3] = 2;
+    bytes.insert(bytes.end(), {0x84, 0x00});
+    uint16_t crc = Crc16(bytes.data(), bytes.size());
+    bytes.push_back(static_cast<uint8_t>(crc));
+    bytes.push_back(static_cast<uint8_t>(crc >> 8));
+    r = Call(m, t.bus, Frame{bytes});
+    CHECK(IsOk(r));
+    CHECK(ParseBatchStatus(r.reply) == (std::vector<uint8_t>{kBatchQueued, kBatchUnknown}));
+    t.commands++;
+    CHECK(CommandLog(m, t.bus, t.slave, t.commands).back() == Logged(PlaySound(1)));
+}
+
+// Different command with the same CRC and length is not a retry. Unused
+// Additional3 of SetLed is chosen so that CRCs collide
+void TestReplayCollision(Master &m, Target &t)
+{
+    Command a = SetLed(6, kLedRed, false);
+    Command b = SetLed(6, kLedGreen, false);
+    Frame fa = UserCommand(t.slave, a);
+    Frame fb;
+    for (uint32_t add3 = 0; add3 <= 0xFFFF; add3++) {
+        b.add3 = static_cast<uint16_t>(add3);
+        fb = UserCommand(t.slave, b);
+        if (fb.bytes[10] == fa.bytes[10] && fb.bytes[11] == fa.bytes[11])
+            break;
+    }
+    CHECK(fb.bytes != fa.bytes);
+    CHECK(std::equal(fa.bytes.end() - 2, fa.bytes.end(), fb.bytes.end() - 2));
+
+    CHECK(IsOk(Call(m, t.bus, fa)));
+    Master::Result r = Call(m, t.bus, fb);
+    CHECK(IsOk(r));
+    CHECK(r.reply == fb.bytes);
+    t.commands += 2;
+    std::vector<uint16_t> log = CommandLog(m, t.bus, t.slave, t.commands);
+    CHECK(log.back() == Logged(b));
+}
+
+// Single command sent while batch is queued runs after it
+void TestBatchOrder(Master &m, Target &t)
+{
+    std::vector<Command> batch{SetLed(5, kLedRed, false), PlaySound(1), SetLed(5, kLedGreen, false)};
+    Command single = SetLed(5, kLedOff, false);
+    Master::Result batchResult, singleResult;
+    m.Submit(t.bus, UserCommandBatch(t.slave, batch), [&](const Master::Result &r) { batchResult = r; });
+    m.Submit(t.bus, UserCommand(t.slave, single), [&](const Master::Result &r) { singleResult = r; });
+    while (m.Pending() != 0)
+        m.Poll(100);
+    CHECK(IsOk(batchResult));
+    CHECK(IsOk(singleResult));
+    t.commands += batch.size() + 1;
+    std::vector<uint16_t> log = CommandLog(m, t.bus, t.slave, t.commands);
+    CHECK(std::vector<uint16_t>(log.end() - 4, log.end())
+          == (std::vector<uint16_t>{Logged(batch[0]), Logged(batch[1]), Logged(batch[2]), Logged(single)}));
+}
+
+// Retried batch is answered from cache and not queued again. Single
+// command that does not fit behind queued batch is refused
+void TestBatchReplayAndBusy(Master &m, Target &t)
+{
+    std::vector<Command> batch;
+    for (uint8_t led = 0; led < 21; led++) // 126 of 128 queue bytes
+        batch.push_back(SetLed(led, kLedOrange, false));
+    Frame f = UserCommandBatch(t.slave, batch);
+    Master::Result first = Call(m, t.bus, f);
+    CHECK(IsOk(first));
+    CHECK(ParseBatchStatus(first.reply) == std::vector<uint8_t>(batch.size(), kBatchQueued));
+    Master::Result retry = Call(m, t.bus, f);
+    CHECK(IsOk(retry));
+    CHECK(retry.reply == first.reply);
+    CHECK(IsException(Call(m, t.bus, UserCommand(t.slave, SetLed(0, kLedOff, false))), kDeviceBusy));
+
+    t.commands += batch.size();
+    std::vector<uint16_t> log = CommandLog(m, t.bus, t.slave, t.commands);
+    CHECK(log.back() == Logged(batch.back()));
+    std::this_thread::sleep_for(std::chrono::milliseconds(3 * PANEL_BATCH_STEP_MS));
+    CHECK(InputRegs(m, t.bus, t.slave)[PANEL_REG_COMMANDS] == t.commands);
+
+    CHECK(IsOk(Call(m, t.bus, UserCommand(t.slave, SetLed(0, kLedOff, false)))));
+    t.commands++;
+}
+
+void TestEepromFile(Master &m, Target &t)
+{
+    std::vector<uint8_t> data{0x11, 0x22, 0x33, 0x44};
+    Frame f = WriteEeprom(t.slave, 20, data);
+    Master::Result r = Call(m, t.bus, f);
+    CHECK(IsOk(r));
+    CHECK(r.reply == f.bytes);
+
+    r = Call(m, t.bus, ReadFileRecords(t.slave, {{kFileEeprom, 10, 2}, {kFileEeprom, 11, 1}}));
+    CHECK(IsOk(r));
+    CHECK(r.reply.size() == 3 + (2 + 4) + (2 + 2) + 2);
+    CHECK(r.reply[2] == (2 + 4) + (2 + 2));
+    std::vector<std::vector<uint8_t>> records = ParseFileRecords(r.reply);
+    CHECK(records.size() == 2);
+    CHECK(records.size() == 2 && records[0] == data);
+    CHECK(records.size() == 2 && records[1] == (std::vector<uint8_t>{0x33, 0x44}));
+
+    // Settings journal is not writable
+    CHECK(IsException(Call(m, t.bus, WriteEeprom(t.slave, kEeSettingsJournal, {0, 0})), kIllegalAddress));
+}
+
+void TestFlashFile(Master &m, Target &t)
+{
+    std::vector<uint8_t> data(kFlashBlockPayload);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = static_cast<uint8_t>(i * 3 + 1);
+    Frame f = WriteFlashBlock(t.slave, 3, data);
+    Master::Result r = Call(m, t.bus, f);
+    CHECK(IsOk(r));
+    CHECK(r.reply == f.bytes);
+
+    // Whole block with erase counter
+    r = Call(m, t.bus, ReadFileRecords(t.slave, {{kFileFlash, 3, kFlashBlockSize / 2}}));
+    CHECK(IsOk(r));
+    std::vector<std::vector<uint8_t>> records = ParseFileRecords(r.reply);
+    CHECK(records.size() == 1);
+    if (records.size() == 1) {
+        CHECK(std::vector<uint8_t>(records[0].begin(), records[0].begin() + kFlashBlockPayload) == data);
+        CHECK(records[0][kFlashBlockPayload] == 1 && records[0][kFlashBlockPayload + 1] == 0);
+    }
+
+    // Staging blocks are file #4, not part of bank
+    CHECK(IsException(Call(m, t.bus, ReadFileRecords(t.slave, {{kFileFlash, kFlashBankBlocks, 1}})),
+                      kIllegalAddress));
+    CHECK(IsException(Call(m, t.bus, WriteFlashBlock(t.slave, kFlashBankBlocks, data)), kIllegalAddress));
+}
+
+void TestStageConfig(Master &m, Target &t)
+{
+    std::vector<uint8_t> image(100);
+    for (size_t i = 0; i < image.size(); i++)
+        image[i] = static_cast<uint8_t>(i * 7 + 3);
+    image[kEeModbusId] = 0x22;
+    image[kEeMaxEvents] = 0;
+    image[kEeEventCount] = 0;
+    std::vector<Frame> frames = StageConfig(t.slave, image);
+    CHECK(frames.size() == 3);
+    for (size_t i = 0; i + 1 < frames.size(); i++)
+        CHECK(IsOk(Call(m, t.bus, frames[i])));
+
+    Master::Result r = Call(m, t.bus, ReadFileRecords(t.slave, {{kFileConfigStage, 0, kFlashBlockPayload / 2}}));
+    CHECK(IsOk(r));
+    std::vector<std::vector<uint8_t>> records = ParseFileRecords(r.reply);
+    CHECK(records.size() == 1
+          && records[0] == std::vector<uint8_t>(image.begin(), image.begin() + kFlashBlockPayload));
+
+    // Commit checks CRC of staged image
+    Frame bad = SystemCommand(t.slave, ConfigCommit(static_cast<uint8_t>(image.size()),
+                                                    Crc16(image.data(), image.size()) ^ 1));
+    CHECK(IsException(Call(m, t.bus, bad), kDeviceFailure));
+
+    CHECK(IsOk(Call(m, t.bus, frames.back())));
+    t.slave = image[kEeModbusId];
+    r = Call(m, t.bus, ReadFileRecords(t.slave, {{kFileEeprom, 0, 50}}));
+    CHECK(IsOk(r));
+    records = ParseFileRecords(r.reply);
+    CHECK(records.size() == 1 && records[0] == image);
+}
+
+// Commit left pending by power loss is copied on boot, only while staging
+// still has the committed CRC
+void TestStagedCommitOnBoot(Master &m, Target &t)
+{
+    std::vector<uint8_t> image(40);
+    for (size_t i = 0; i < image.size(); i++)
+        image[i] = static_cast<uint8_t>(i * 5 + 1);
+    image[kEeModbusId] = t.slave;
+    image[kEeMaxEvents] = 0;
+    image[kEeEventCount] = 0;
+    for (const Frame &f : StageConfig(t.slave, image))
+        CHECK(IsOk(Call(m, t.bus, f)));
+
+    std::vector<uint8_t> next = image;
+    next[20] ^= 0xFF;
+    std::vector<Frame> frames = StageConfig(t.slave, next);
+    for (size_t i = 0; i + 1 < frames.size(); i++)
+        CHECK(IsOk(Call(m, t.bus, frames[i])));
+    CHECK(IsOk(Call(m, t.bus, WriteCoil(t.slave, PANEL_COIL_SKIP_COPY, true))));
+    CHECK(IsOk(Call(m, t.bus, frames.back())));
+    Master::Result r = Call(m, t.bus, ReadFileRecords(t.slave, {{kFileEeprom, 0, 20}}));
+    CHECK(IsOk(r) && ParseFileRecords(r.reply) == std::vector<std::vector<uint8_t>>{image});
+
+    // Staging rewritten after commit, pending copy is dropped
+    std::vector<uint8_t> other = next;
+    other[21] ^= 0xFF;
+    frames = StageConfig(t.slave, other);
+    CHECK(IsOk(Call(m, t.bus, frames.front())));
+    CHECK(Call(m, t.bus, SystemCommand(t.slave, Reset()), 200ms).status == Master::Status::Timeout);
+    r = Call(m, t.bus, ReadFileRecords(t.slave, {{kFileEeprom, 0, 20}}));
+    CHECK(IsOk(r) && ParseFileRecords(r.reply) == std::vector<std::vector<uint8_t>>{image});
+
+    // Untouched staging is copied on boot. Image differs from the ones
+    // above, replay cache would answer the same frames
+    next[22] ^= 0xFF;
+    CHECK(IsOk(Call(m, t.bus, WriteCoil(t.slave, PANEL_COIL_SKIP_COPY, true))));
+    for (const Frame &f : StageConfig(t.slave, next))
+        CHECK(IsOk(Call(m, t.bus, f)));
+    CHECK(Call(m, t.bus, SystemCommand(t.slave, Reset()), 200ms).status == Master::Status::Timeout);
+    r = Call(m, t.bus, ReadFileRecords(t.slave, {{kFileEeprom, 0, 20}}));
+    CHECK(IsOk(r) && ParseFileRecords(r.reply) == std::vector<std::vector<uint8_t>>{next});
+}
+
+void TestErrors(Master &m, Target &t)
+{
+    CHECK(IsException(Call(m, t.bus, ReadRegisters(t.slave, kReadHoldingRegisters, 200, 1)), kIllegalAddress));
+    CHECK(Call(m, t.bus, ReadDeviceStatus(t.slave ^ 0x11), 100ms).status == Master::Status::Timeout);
+    CHECK(IsOk(Call(m, t.bus, ReadDeviceStatus(t.slave))));
+}
+
+// Panel takes only frames with its own id, broadcast just holds the bus
+void TestBroadcast(Master &m, Target &t)
+{
+    uint16_t time = InputRegs(m, t.bus, t.slave)[PANEL_REG_TIME];
+    Master::Result r = Call(m, t.bus, SystemCommand(kBroadcast, SetTime(TestTime(6, 5))));
+    CHECK(IsOk(r));
+    CHECK(r.reply.empty());
+    CHECK(InputRegs(m, t.bus, t.slave)[PANEL_REG_TIME] == time);
+}
+
+// Reset is not answered, device comes back with time not set
+void TestReset(Master &m, Target &t)
+{
+    CHECK(Call(m, t.bus, SystemCommand(t.slave, Reset()), 200ms).status == Master::Status::Timeout);
+    Master::Result r = Call(m, t.bus, ReadDeviceStatus(t.slave));
+    CHECK(IsOk(r));
+    CHECK(!(ParseDeviceStatus(r.reply) & 1 << kStatusTimeSet));
+}
+
+void TestSetAddress(Master &m, Target &t)
+{
+    CHECK(IsOk(Call(m, t.bus, SystemCommand(t.slave, SetAddress(0x31)))));
+    t.slave = 0x31;
+    CHECK(IsOk(Call(m, t.bus, ReadDeviceStatus(t.slave))));
+}
+
+// Settings journal ring and its sequence numbers wrap many times, newest
+// address must survive every reboot
+void TestSettingsJournal(Master &m, Target &t)
+{
+    for (int i = 0; i < 270; i++) {
+        uint8_t slave = static_cast<uint8_t>(0x40 + i % 32);
+        CHECK(IsOk(Call(m, t.bus, SystemCommand(t.slave, SetAddress(slave)))));
+        t.slave = slave;
+        if (i % 9 != 0)
+            continue;
+        CHECK(Call(m, t.bus, SystemCommand(t.slave, Reset()), 50ms).status == Master::Status::Timeout);
+        CHECK(IsOk(Call(m, t.bus, ReadDeviceStatus(t.slave))));
+    }
+}
+
+// Requests to two panels are served side by side
+void TestTwoBuses(Master &m, Target &a, Target &b)
+{
+    int ok = 0;
+    for (int i = 0; i < 10; i++) {
+        for (Target *t : {&a, &b})
+            m.Submit(t->bus, ReadRegisters(t->slave, kReadInputRegisters, 0, PANEL_INPUT_REGS),
+                     [&](const Master::Result &r) { ok += IsOk(r); });
+    }
+    while (m.Pending() != 0)
+        m.Poll(100);
+    CHECK(ok == 20);
+}
+
+} // namespace
+
+int main()
+{
+    signal(SIGPIPE, SIG_IGN);
+    Master master;
+    Target a{master.AddBus(StartPanel().fd, 9600), kDefaultSlaveId, 0};
+    Target b{master.AddBus(StartPanel().fd, 9600), kDefaultSlaveId, 0};
+
+    TestBatchedSizes();
+    TestDeviceStatus(master, a);
+    TestSetTime(master, a);
+    TestUserCommand(master, a);
+    TestReplayCollision(master, a);
+    TestBatch(master, a);
+    TestBatchOrder(master, a);
+    TestBatchReplayAndBusy(master, a);
+    TestEepromFile(master, a);
+    TestFlashFile(master, a);
+    TestStageConfig(master, a);
+    TestStagedCommitOnBoot(master, a);
+    TestErrors(master, a);
+    TestBroadcast(master, a);
+    TestReset(master, a);
+    TestSetAddress(master, b);
+    TestSettingsJournal(master, b);
+    TestTwoBuses(master, a, b);
+
+    StopPanels();
+    if (failures != 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("master tests passed\n");
+    return 0;
+}
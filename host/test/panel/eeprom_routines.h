@@ -0,0 +1,7 @@
+#ifndef PANEL_EEPROM_ROUTINES_H
+#define PANEL_EEPROM_ROUTINES_H
+
+unsigned char eeprom_read(unsigned char address);
+void eeprom_write(unsigned char address, unsigned char value);
+
+#endif // PANEL_EEPROM_ROUTINES_H
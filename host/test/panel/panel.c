@@ -0,0 +1,244 @@
+// Firmware half of panel emulation: stands in for interrupts.c, flash.c,
+// calendar setters and main loop of the panel. Application keeps log of
+// user commands run in input registers, master reads it back.
+
+#include <xc.h>
+#include <setjmp.h>
+#include <string.h>
+
+#include "system.h"
+#include "interrupts.h"
+#include "flash.h"
+#include "settings.h"
+#include "ModbusRtu.h"
+#include "panel.h"
+
+#define T35_MS ((TIMER3_T35_TICKS * 1000L + (FCY) - 1) / (FCY))
+
+volatile INTCONbits_t INTCONbits;
+volatile unsigned char WR;
+
+static uint8_t _eeprom[_EEPROMSIZE];
+static uint8_t _flash[FLASH_BLOCKS_COUNT][FLASH_BLOCK_SIZE];
+
+static jmp_buf _resetJump;
+
+static uint16_t _coils;
+static uint16_t _inputRegs[PANEL_INPUT_REGS];
+static uint16_t _holdingRegs[PANEL_HOLDING_REGS];
+
+// EEPROM
+
+uint8_t _EEREG_EEPROM_READ(uint8_t address)
+{
+    return _eeprom[address];
+}
+
+uint8_t eeprom_read(uint8_t address)
+{
+    return _eeprom[address];
+}
+
+void eeprom_write(uint8_t address, uint8_t value)
+{
+    _eeprom[address] = value;
+}
+
+// Flash storage, same block layout as flash.c
+
+uint8_t FlashReadRaw(uint8_t blockNum, uint8_t pos)
+{
+    return _flash[blockNum][pos];
+}
+
+uint8_t FlashRead(uint16_t offset)
+{
+    return _flash[offset / FLASH_BLOCK_PAYLOAD][offset % FLASH_BLOCK_PAYLOAD];
+}
+
+uint16_t FlashEraseCount(uint8_t blockNum)
+{
+    uint16_t count = word(_flash[blockNum][FLASH_BLOCK_PAYLOAD + 1], _flash[blockNum][FLASH_BLOCK_PAYLOAD]);
+    return count == 0xFFFF ? 0 : count;
+}
+
+uint16_t FlashWriteBlock(uint8_t blockNum, uint8_t *data)
+{
+    uint16_t count = FlashEraseCount(blockNum);
+    if(count < FLASH_ERASE_COUNT_MAX)
+        count++;
+    memcpy(_flash[blockNum], data, FLASH_BLOCK_PAYLOAD);
+    _flash[blockNum][FLASH_BLOCK_PAYLOAD] = LOW_BYTE(count);
+    _flash[blockNum][FLASH_BLOCK_PAYLOAD + 1] = HIGH_BYTE(count);
+    return count;
+}
+
+// Clock, only time set by master is shown
+
+void SetHourMin(uint8_t *newHour, uint8_t *newMin, uint8_t *sec)
+{
+    _inputRegs[PANEL_REG_TIME] = word(*newHour, *newMin);
+}
+
+void SetDate(uint16_t date)
+{
+}
+
+void SetTime(time_t *newTime)
+{
+}
+
+void WatchCalibrate(time_t *masterTime)
+{
+}
+
+unsigned long millis()
+{
+    return PanelMillis();
+}
+
+// Device does not answer after reset, RAM of Modbus code is kept
+void PanelReset(void)
+{
+    longjmp(_resetJump, 1);
+}
+
+// UART. Frame ends after T35 of silence, then fast path or main loop
+// takes it, as RX and Timer3 interrupts do
+
+uint8_t _frameSlots[2][FRAME_SLOT_SIZE];
+static uint8_t *_rxFrame = _frameSlots[0];
+static uint8_t *_takenFrame = _frameSlots[1];
+static uint8_t _rxLen;
+static bool _rxFrameReady;
+static bool _rxFrameCorrupt;
+
+bool PortFrameReady()
+{
+    return _rxFrameReady;
+}
+
+uint8_t *PortFrameBuffer()
+{
+    return _takenFrame;
+}
+
+uint8_t *PortTakeFrame(uint8_t *len, bool *corrupt)
+{
+    uint8_t *frame = _rxFrame;
+    _rxFrame = _takenFrame;
+    *len = _rxLen;
+    *corrupt = _rxFrameCorrupt;
+    _rxLen = 0;
+    _rxFrameCorrupt = false;
+    _rxFrameReady = false;
+    _takenFrame = frame;
+    return frame;
+}
+
+void PortClearReadBuffer()
+{
+    _rxLen = 0;
+    _rxFrameCorrupt = false;
+    _rxFrameReady = false;
+}
+
+void PortGetErrors(uint8_t *overruns, uint8_t *framingErrors)
+{
+    *overruns = 0;
+    *framingErrors = 0;
+}
+
+void PortWrite(uint8_t *buf, uint8_t buflen)
+{
+    PanelPortWrite(buf, buflen);
+}
+
+// Bytes received until T35 silence
+static void PortReceive()
+{
+    uint8_t buf[64];
+    int n = PanelPortRead(buf, sizeof(buf), _rxLen != 0 ? T35_MS : 1);
+    if(n < 0)
+        longjmp(_resetJump, 2);
+    for(int i = 0; i < n; i++)
+    {
+        if(_rxFrameReady)
+            continue;
+        if(_rxLen >= FRAME_SLOT_SIZE)
+        {
+            _rxFrameCorrupt = true;
+            continue;
+        }
+        _rxFrame[_rxLen++] = buf[i];
+    }
+    if(n != 0 || _rxLen == 0 || _rxFrameReady)
+        return;
+    uint8_t replyLen;
+    if(!_rxFrameCorrupt && ModbusFastPath(_rxFrame, _rxLen, &replyLen))
+    {
+        _rxLen = 0;
+        if(replyLen != 0)
+            PanelPortWrite(_rxFrame, replyLen);
+    }
+    else
+        _rxFrameReady = true;
+}
+
+// Application
+
+static void ProcessUserCommands()
+{
+    // Batch itself and commands queued behind it are run by main loop,
+    // only commands of main.c are logged
+    if(UserCommandSize(*ModbusGetUserCommandId()) == 0)
+        return;
+    uint16_t n = _inputRegs[PANEL_REG_COMMANDS];
+    _inputRegs[PANEL_REG_LOG + n % PANEL_LOG_LEN] = word(*ModbusGetUserCommandId(), *ModbusGetUserCommandData());
+    _inputRegs[PANEL_REG_COMMANDS] = n + 1;
+}
+
+static void io_poll()
+{
+    uint16_t lastAddress;
+    uint16_t lastCount;
+    uint8_t lastCommand;
+    uint8_t *lastFunction = ModbusGetLastCommand(&lastAddress, &lastCount, &lastCommand);
+    if(*lastFunction == MB_FC_SYSTEM_COMMAND)
+    {
+        if(lastCommand == MB_COMMAND_CONFIG_COMMIT && (_coils & 1 << PANEL_COIL_SKIP_COPY))
+            _coils &= ~(1 << PANEL_COIL_SKIP_COPY);
+        else if(lastCommand == MB_COMMAND_CONFIG_COMMIT && SettingsStagedApply())
+            ModbusLoadID();
+        return;
+    }
+    if(*lastFunction == MB_FC_USER_COMMAND)
+        ProcessUserCommands();
+}
+
+void PanelRun(int fd)
+{
+    memset(_eeprom, 0xFF, sizeof(_eeprom));
+    memset(_flash, 0xFF, sizeof(_flash));
+    PanelPortOpen(fd);
+    if(setjmp(_resetJump) == 2)
+        return;
+    PortClearReadBuffer();
+    SettingsInit();
+    SettingsStagedApply();
+    Modbus(0, 0);
+    ModbusSetReplayWindow(MODBUS_REPLAY_WINDOW_MS);
+
+    unsigned long lastBatchMs = millis();
+    while(true)
+    {
+        PortReceive();
+        ModbusPoll(0, &_coils, _inputRegs, PANEL_INPUT_REGS, _holdingRegs, PANEL_HOLDING_REGS);
+        io_poll();
+        if(millis() - lastBatchMs < PANEL_BATCH_STEP_MS)
+            continue;
+        lastBatchMs = millis();
+        if(ModbusTakeBatchCommand())
+            ProcessUserCommands();
+    }
+}
@@ -0,0 +1,42 @@
+// Host build of the panel Modbus slave, for master tests over a pty.
+// ModbusRtu.c, settings.c, calendar.c and eventlog.c are the firmware
+// sources; EEPROM, flash, UART and the main loop are emulated.
+
+#ifndef PANEL_H
+#define PANEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Input registers of emulated application
+#define PANEL_REG_COMMANDS 0   // User commands run
+#define PANEL_REG_LOG 1        // word(id, data) of last PANEL_LOG_LEN commands, ring
+#define PANEL_LOG_LEN 8
+#define PANEL_REG_TIME 9       // word(hour, minute) of last SET_TIME
+#define PANEL_INPUT_REGS 10
+#define PANEL_HOLDING_REGS 10
+// Coil set by master: next config commit is left pending, like power lost
+// before main loop copies it
+#define PANEL_COIL_SKIP_COPY 0
+
+// One batched command per step, like main loop busy with LEDs and sound
+#define PANEL_BATCH_STEP_MS 20
+
+// Serve Modbus on fd until master side is closed
+void PanelRun(int fd);
+// Firmware batch sub-command size, ModbusRtu.c
+unsigned char UserCommandSize(unsigned char commandId);
+
+// POSIX side, port.c
+void PanelPortOpen(int fd);
+// Bytes read, 0 - nothing within timeoutMs, -1 - closed
+int PanelPortRead(unsigned char *buf, int size, int timeoutMs);
+void PanelPortWrite(const unsigned char *buf, int len);
+unsigned long PanelMillis(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PANEL_H
@@ -0,0 +1,53 @@
+// POSIX half of panel emulation. Firmware headers redefine fixed width
+// types, so system headers are kept apart from them here.
+
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "panel.h"
+
+static int _fd = -1;
+
+void PanelPortOpen(int fd)
+{
+    _fd = fd;
+}
+
+int PanelPortRead(unsigned char *buf, int size, int timeoutMs)
+{
+    struct pollfd pfd = {_fd, POLLIN, 0};
+    int ready = poll(&pfd, 1, timeoutMs);
+    if (ready < 0)
+        return errno == EINTR ? 0 : -1;
+    if (ready == 0)
+        return 0;
+    ssize_t n = read(_fd, buf, size);
+    if (n > 0)
+        return (int)n;
+    if (n < 0 && (errno == EAGAIN || errno == EINTR))
+        return 0;
+    return -1; // EOF or EIO - master side closed
+}
+
+void PanelPortWrite(const unsigned char *buf, int len)
+{
+    while (len > 0) {
+        ssize_t n = write(_fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            return;
+        }
+        buf += n;
+        len -= (int)n;
+    }
+}
+
+unsigned long PanelMillis(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
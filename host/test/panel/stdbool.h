@@ -0,0 +1 @@
+// bool, true and false are defined by system.h
@@ -0,0 +1,8 @@
+// system.h defines XC8 integer types itself, rest of them is here
+#ifndef PANEL_STDINT_H
+#define PANEL_STDINT_H
+
+typedef short int16_t;
+typedef int int32_t;
+
+#endif // PANEL_STDINT_H
@@ -0,0 +1,32 @@
+// Host build of firmware Modbus code: just what ModbusRtu.c, settings.c,
+// calendar.c and eventlog.c use from the XC8 device header.
+
+#ifndef PANEL_XC_H
+#define PANEL_XC_H
+
+#include <stdint.h>
+
+#define _EEPROMSIZE 256
+
+typedef struct {
+    unsigned GIEL : 1;
+    unsigned GIE : 1;
+} INTCONbits_t;
+extern volatile INTCONbits_t INTCONbits;
+
+// EEPROM write in progress, EEPROM is written at once here
+extern volatile unsigned char WR;
+
+#define di() ((void)0)
+#define ei() ((void)0)
+#define __delay_us(x) ((void)0)
+#define __delay_ms(x) ((void)0)
+#define RESET() PanelReset()
+void PanelReset(void);
+
+unsigned char _EEREG_EEPROM_READ(unsigned char address);
+
+#define HIGH_BYTE(x) ((unsigned char)((x) >> 8))
+#define LOW_BYTE(x) ((unsigned char)((x) & 0xFF))
+
+#endif // PANEL_XC_H
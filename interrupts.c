@@ -20,65 +20,121 @@
 #include "system.h"
 #include "user.h"
 #include "interrupts.h"
+#include "calendar.h"
+#include "settings.h"
+#include "ModbusRtu.h"
+#include "buttons.h"
 
 #define	TXE_DELAY 	10
 
 #define TIME_NOT_SET 0xFF
 
-static volatile unsigned long millisecondsFromStart = 0;
+// Time at last Timer1 overflow, remainder in half ticks not counted in ms
+static volatile unsigned long _msBase = 0;
+static volatile uint16_t _msRemainder = 0;
+static volatile uint8_t _timer1Overflows = 0;
+
+static unsigned long _deadlines[DEADLINES_COUNT];
+static volatile bool _deadlineArmed[DEADLINES_COUNT];
+static volatile bool _deadlineDue[DEADLINES_COUNT];
+static unsigned long _buttonsScanMs = 0; // Next inputs scan, fixed rate
 static volatile uint8_t globalMinutes = 0;
 static volatile uint16_t _totalMinutesFromDayStart = 0;
 static volatile uint8_t _6sCounter = 0;
 static volatile uint8_t globalHours = TIME_NOT_SET;
+static volatile uint16_t _date = DATE_NOT_SET; // Days from 01.01.2000
+// Incremented after every change of minutes, hours and date.
+// Reader repeats if it changed while reading, no need to disable interrupts
+static volatile uint8_t _timeSeq = 0;
+
+static volatile int16_t _watchCorrection = 0; // 1/256 tick per 6 sec, + slows watch
+static uint8_t _watchFraction = 0;
+// Calibration reference - master time of first sync and sum of errors since
+static time_t _calibrationStart = 0;
+static int32_t _calibrationDriftMs = 0;
+static bool _calibrationStarted = false;
 //static volatile time_t currentTime = 0;
 
 
 // UART Buffer
 
-#define UART_BUF_LEN 256u
-static volatile uint8_t UartBufferHead;
-static volatile uint8_t UartBufferTail;
-static volatile uint8_t UartBufferLen;
-static volatile uint8_t UartRingBuffer[UART_BUF_LEN];
+// Two frame slots are shared between UART receiver and Modbus code.
+// Receiver fills one slot, Modbus parses and builds answer in place in
+// the other one. Slots are swapped when frame is taken, so no copy.
+uint8_t _frameSlots[2][FRAME_SLOT_SIZE];
+static uint8_t *_rxFrame = _frameSlots[0]; // written only by RX interrupt
+static uint8_t *_takenFrame = _frameSlots[1];
+static volatile uint8_t _rxLen;
+// Set by frame timer after T35 silence, frame waits for main loop
+static volatile bool _rxFrameReady = false;
+// Set when received byte is lost, frame in buffer must be dropped
+static volatile bool _rxFrameCorrupt = false;
+static volatile uint8_t _rxOverrunErrors = 0; // OERR and full buffer
+static volatile uint8_t _rxFramingErrors = 0;
+
+// Answer is sent by TX interrupt, buffer must stay untouched until done
+static uint8_t *_txBuf;
+static volatile uint8_t _txLen;
+static volatile uint8_t _txPos;
+static volatile bool _txBusy = false;
+
+// Used with low priority interrupts masked or from low_isr only
+#define PortTxStart(buf, len) do { \
+    LATCbits.LATC5 = 1; \
+    __delay_us(TXE_DELAY); \
+    _txBuf = (buf); \
+    _txLen = (len); \
+    _txPos = 0; \
+    _txBusy = true; \
+    PIE1bits.TXIE = 1; \
+} while(0)
 
 void InitUartBuffer()
 {
-    UartBufferHead = 0;
-    UartBufferTail = 0;
-    UartBufferLen = 0;
+    _rxLen = 0;
 }
 
 
-uint8_t PortAvailable()
+bool PortFrameReady()
 {
-    return UartBufferLen;
+    return _rxFrameReady;
 }
 
-uint8_t PortRead()
+uint8_t *PortFrameBuffer()
 {
-    di();
-    if(UartBufferLen > 0)
-    {
-    
-        uint8_t ret = UartRingBuffer[UartBufferTail];
-        UartBufferLen--;
-        if(UartBufferTail == UART_BUF_LEN - 1)
-            UartBufferTail = 0;
-        else
-            UartBufferTail++;
-        ei();
-        return ret;
-    }
-    ei();
-    return 0;
+    return _takenFrame;
+}
+
+uint8_t *PortTakeFrame(uint8_t *len, bool *corrupt)
+{
+    LowIsrLock();
+    uint8_t *frame = _rxFrame;
+    // Slot taken before is free now, answer on it was already sent
+    _rxFrame = _takenFrame;
+    *len = _rxLen;
+    *corrupt = _rxFrameCorrupt;
+    _rxLen = 0;
+    _rxFrameCorrupt = false;
+    _rxFrameReady = false;
+    LowIsrUnlock();
+    _takenFrame = frame;
+    return frame;
 }
 
 
 void PortClearReadBuffer()
 {
-    di();
-    InitUartBuffer();
-    ei();
+    LowIsrLock();
+    _rxLen = 0;
+    _rxFrameCorrupt = false;
+    _rxFrameReady = false;
+    LowIsrUnlock();
+}
+
+void PortGetErrors(uint8_t *overruns, uint8_t *framingErrors)
+{
+    *overruns = _rxOverrunErrors;
+    *framingErrors = _rxFramingErrors;
 }
 
 //void SetRS485TxPin(bool value)
@@ -98,17 +154,14 @@ void PortWriteByte(uint8_t b)
 }
  */
 
+// Returns when buf is sent, answer of fast path may still be going out
 void PortWrite(uint8_t *buf, uint8_t buflen)
 {
-    LATCbits.LATC5 = 1;
-    __delay_us(TXE_DELAY);
-    for(uint8_t i = 0; i < buflen; i++)
-    {
-        while(!TRMT);
-        TXREG = buf[i];
-    }
-    while(!TRMT);
-    LATCbits.LATC5 = 0;
+    while(_txBusy);
+    LowIsrLock();
+    PortTxStart(buf, buflen);
+    LowIsrUnlock();
+    while(_txBusy);
 }
 
 
@@ -116,6 +169,51 @@ void PortWrite(uint8_t *buf, uint8_t buflen)
 /* Interrupt Routines                                                         */
 /******************************************************************************/
 
+// ticks * 2 + remainder can exceed 16 bit, divide ticks first
+static unsigned long TimebaseMs(unsigned long base, uint16_t remainder, uint16_t ticks)
+{
+    uint16_t q = ticks / TIMER1_HALF_TICKS_IN_1_MS;
+    uint16_t r = ticks % TIMER1_HALF_TICKS_IN_1_MS;
+    return base + q * 2 + (r * 2 + remainder) / TIMER1_HALF_TICKS_IN_1_MS;
+}
+
+// Interrupt only. Scan inputs, mark due deadlines and set compare to the
+// nearest one. Inputs scan keeps compare interrupt running every
+// BUTTONS_SCAN_MS
+static void DeadlinesService()
+{
+    uint16_t ticks = READTIMER1();
+    unsigned long now = TimebaseMs(_msBase, _msRemainder, ticks);
+    long nearest = (long)(_buttonsScanMs - now);
+    if(nearest <= 0)
+    {
+        ButtonsScan();
+        _buttonsScanMs += BUTTONS_SCAN_MS;
+        nearest = (long)(_buttonsScanMs - now);
+        if(nearest <= 0) // interrupts were off for long, do not catch up
+        {
+            _buttonsScanMs = now + BUTTONS_SCAN_MS;
+            nearest = BUTTONS_SCAN_MS;
+        }
+    }
+    for(uint8_t i = 0; i < DEADLINES_COUNT; i++)
+    {
+        if(!_deadlineArmed[i])
+            continue;
+        long left = (long)(_deadlines[i] - now);
+        if(left <= 0)
+        {
+            _deadlineArmed[i] = false;
+            _deadlineDue[i] = true;
+            continue;
+        }
+        if(left < nearest)
+            nearest = left;
+    }
+    if(nearest <= DEADLINE_COMPARE_MAX_MS)
+        CCPR2 = ticks + (uint16_t)((nearest * TIMER1_HALF_TICKS_IN_1_MS + 1) / 2);
+}
+
 /* High-priority service */
 
 #if defined(__XC) || defined(HI_TECH_C)
@@ -140,11 +238,25 @@ void high_isr(void)
       /* TODO Add High Priority interrupt routine code here. */
 
       /* Determine which flag generated the interrupt */
-      if(PIR1bits.TMR1IF && PIE1bits.TMR1IE) // milliseconds timer
+      if(PIR1bits.TMR1IF && PIE1bits.TMR1IE) // Timer1 overflow, ~209.7 ms
       {
         PIR1bits.TMR1IF = 0; /* Clear Interrupt Flag 1 */
-        millisecondsFromStart++; 
-        WRITETIMER1(TIMER_TICKS_IN_1_MS);
+        _msBase += TIMER1_MS_PER_OVERFLOW;
+        _msRemainder += TIMER1_REMAINDER_PER_OVERFLOW;
+        if(_msRemainder >= TIMER1_HALF_TICKS_IN_1_MS)
+        {
+            _msRemainder -= TIMER1_HALF_TICKS_IN_1_MS;
+            _msBase++;
+        }
+        _timer1Overflows++;
+        DeadlinesService();
+        return;
+      }
+      
+      if(PIR2bits.CCP2IF && PIE2bits.CCP2IE) // Deadline compare or new deadline
+      {
+        PIR2bits.CCP2IF = 0;
+        DeadlinesService();
         return;
       }
       
@@ -165,10 +277,15 @@ void high_isr(void)
                   {
                       _totalMinutesFromDayStart = 0;
                       globalHours = 0;
+                      if(_date != DATE_NOT_SET)
+                          _date++;
                   }
               }
+              _timeSeq++;
           }
-          WRITETIMER0(WATCH_TIMER_TICKS_TO_END_6S);
+          int16_t correction = _watchFraction + _watchCorrection;
+          _watchFraction = (uint8_t)correction;
+          WRITETIMER0(WATCH_TIMER_TICKS_TO_END_6S - (correction >> 8));
           return;
       }
 
@@ -196,30 +313,85 @@ void low_isr(void)
       time errors. */
       if (PIR1bits.RCIF && PIE1bits.RCIE)
       {
-//        while(!RCIF);
-//        uint8_t c = RCREG;
-//        UartBufferLen++;
-//        PIR1bits.RCIF = 0;
-        if(UartBufferLen == UART_BUF_LEN) // if buffer is full
+        // Frame ends after 3.5 characters of silence
+        T3CONbits.TMR3ON = 0;
+        WRITETIMER3(0x10000 - TIMER3_T35_TICKS);
+        PIR2bits.TMR3IF = 0;
+        T3CONbits.TMR3ON = 1;
+        // Overrun stops receiver until CREN is cycled
+        if(RCSTAbits.OERR)
         {
-            while(!RCIF);
-            PIR1bits.RCIF = 0;
+            RCSTAbits.CREN = 0;
+            RCSTAbits.CREN = 1;
+            // Drop bytes left in 2 byte FIFO, RCIF is cleared by reading
+            while(PIR1bits.RCIF)
+                (void)RCREG;
+            _rxOverrunErrors++;
+            _rxFrameCorrupt = true;
             return;
         }
-        
-        while(!RCIF);
+        // FERR is for the byte on top of FIFO, read it before RCREG
+        bool framingError = RCSTAbits.FERR;
         uint8_t c = RCREG;
+        // Our own answer seen by transceiver, master does not talk now
+        if(_txBusy)
+            return;
+        if(framingError)
+        {
+            _rxFramingErrors++;
+            _rxFrameCorrupt = true;
+            return;
+        }
+        // Previous frame is not taken by main loop yet, master must wait
+        // for our answer. Rest of this frame fails CRC after take, it is
+        // master timing error, not UART one, so not counted
+        if(_rxFrameReady)
+            return;
+        uint8_t len = _rxLen;
+        if(len >= FRAME_SLOT_SIZE) // frame is longer than slot
+        {
+            _rxOverrunErrors++;
+            _rxFrameCorrupt = true;
+            return;
+        }
        
-        //uint8_t var_head = UartBufferHead;     // we create temporary variable
-        UartRingBuffer[UartBufferHead] = c; // save the data in FIFO head
-        UartBufferLen++;// increment counter of waiting bytes
-        if(UartBufferHead == UART_BUF_LEN - 1)
-            UartBufferHead = 0;
-        else
-            UartBufferHead++;
-        
-        // reset interrupt
-        PIR1bits.RCIF = 0;
+        _rxFrame[len] = c;
+        _rxLen = len + 1;
+        return;
+      }
+      if (PIR2bits.TMR3IF && PIE2bits.TMR3IE)
+      {
+        T3CONbits.TMR3ON = 0;
+        PIR2bits.TMR3IF = 0;
+        if(_rxLen != 0 && !_rxFrameReady)
+        {
+            // Foreign frames and register reads are done here,
+            // so read latency does not depend on main loop
+            uint8_t replyLen;
+            if(!_rxFrameCorrupt && ModbusFastPath(_rxFrame, _rxLen, &replyLen))
+            {
+                _rxLen = 0;
+                // Receiver ignores bytes until sent, slot is not overwritten
+                if(replyLen != 0)
+                    PortTxStart(_rxFrame, replyLen);
+            }
+            else
+                _rxFrameReady = true;
+        }
+        return;
+      }
+      if (PIR1bits.TXIF && PIE1bits.TXIE)
+      {
+        if(_txPos < _txLen)
+        {
+            TXREG = _txBuf[_txPos++];
+            return;
+        }
+        // Last byte is in shift register, at most one character time
+        PIE1bits.TXIE = 0;
+        while(!TRMT);
+        LATCbits.LATC5 = 0;
+        _txBusy = false;
         return;
       }
 #if 0
@@ -246,32 +418,102 @@ void low_isr(void)
 
 unsigned long millis()
 {
-    // millisecondsFromStart can changed while read;
-    di();
-    unsigned long ret = millisecondsFromStart;
-    ei();
-    return ret;
+    // Overflow can happen while read, read again if so
+    uint8_t seq;
+    unsigned long base;
+    uint16_t remainder, ticks;
+    bool overflowPending;
+    do
+    {
+        seq = _timer1Overflows;
+        base = _msBase;
+        remainder = _msRemainder;
+        ticks = READTIMER1();
+        overflowPending = PIR1bits.TMR1IF;
+    } while(seq != _timer1Overflows);
+    // Overflow not counted yet, interrupts are disabled
+    if(overflowPending && ticks < 0x8000)
+    {
+        base += TIMER1_MS_PER_OVERFLOW;
+        remainder += TIMER1_REMAINDER_PER_OVERFLOW;
+    }
+    return TimebaseMs(base, remainder, ticks);
 }
 
-bool getHourMin(uint8_t *hour, uint8_t *min)
+void SetDeadline(uint8_t deadline, unsigned long ms)
 {
-    if(globalHours == TIME_NOT_SET)
+    _deadlineArmed[deadline] = false;
+    _deadlineDue[deadline] = false;
+    _deadlines[deadline] = ms;
+    _deadlineArmed[deadline] = true;
+    PIR2bits.CCP2IF = 1; // Interrupt sets compare
+}
+
+void CancelDeadline(uint8_t deadline)
+{
+    _deadlineArmed[deadline] = false;
+    _deadlineDue[deadline] = false;
+}
+
+bool DeadlineDue(uint8_t deadline)
+{
+    if(!_deadlineDue[deadline])
         return false;
-    di();
-    *hour = globalHours;
-    *min = globalMinutes;
-    ei();
+    _deadlineDue[deadline] = false;
     return true;
 }
 
+bool getHourMin(uint8_t *hour, uint8_t *min)
+{
+    uint8_t seq;
+    do
+    {
+        seq = _timeSeq;
+        *hour = globalHours;
+        *min = globalMinutes;
+    } while(seq != _timeSeq);
+    return *hour != TIME_NOT_SET;
+}
+
 bool getTotalMinutes(uint16_t *totalMinutes)
 {
-    if(globalHours == TIME_NOT_SET)
+    uint8_t seq;
+    uint8_t hours;
+    do
+    {
+        seq = _timeSeq;
+        hours = globalHours;
+        *totalMinutes = _totalMinutesFromDayStart;
+    } while(seq != _timeSeq);
+    return hours != TIME_NOT_SET;    
+}
+
+bool getDate(uint16_t *date)
+{
+    uint8_t seq;
+    do
+    {
+        seq = _timeSeq;
+        *date = _date;
+    } while(seq != _timeSeq);
+    return *date != DATE_NOT_SET;
+}
+
+bool getDayOfWeek(uint8_t *dayOfWeek)
+{
+    uint16_t date;
+    if(!getDate(&date))
         return false;
+    *dayOfWeek = DayOfWeek(date);
+    return true;
+}
+
+void SetDate(uint16_t date)
+{
     di();
-    *totalMinutes = _totalMinutesFromDayStart;
+    _date = date;
+    _timeSeq++;
     ei();
-    return true;    
 }
 
 void SetHourMin(uint8_t *newHour, uint8_t *newMin, uint8_t *sec)
@@ -281,6 +523,7 @@ void SetHourMin(uint8_t *newHour, uint8_t *newMin, uint8_t *sec)
     globalHours = *newHour;
     globalMinutes = *newMin;
     _totalMinutesFromDayStart = globalHours * 60 + globalMinutes;
+    _timeSeq++;
     
     uint8_t tmpSec = *sec;
     _6sCounter = tmpSec / 6;
@@ -289,3 +532,76 @@ void SetHourMin(uint8_t *newHour, uint8_t *newMin, uint8_t *sec)
     
     T0CONbits.TMR0ON = 1; // Switch on timer
 }
+
+int16_t GetWatchCorrection()
+{
+    return _watchCorrection;
+}
+
+static void SetWatchCorrection(int16_t correction)
+{
+    if(correction > WATCH_CORRECTION_LIMIT)
+        correction = WATCH_CORRECTION_LIMIT;
+    if(correction < -WATCH_CORRECTION_LIMIT)
+        correction = -WATCH_CORRECTION_LIMIT;
+    di();
+    _watchCorrection = correction;
+    ei();
+}
+
+void WatchLoadCorrection()
+{
+    uint8_t lo = SettingGet(SETTING_WATCH_CORRECTION_LO);
+    uint8_t hi = SettingGet(SETTING_WATCH_CORRECTION_HI);
+    if(lo == 0xFF && hi == 0xFF) // never calibrated
+        lo = hi = 0;
+    SetWatchCorrection((int16_t)word(hi, lo));
+}
+
+// Call on master time sync before the watch is set.
+// Errors of all syncs are summed, after WATCH_CALIBRATION_MIN_INTERVAL
+// the drift per 6 sec period is added to correction and saved.
+void WatchCalibrate(time_t *masterTime)
+{
+    uint8_t hours, minutes, counter6s;
+    uint16_t date, ticks;
+    di();
+    hours = globalHours;
+    minutes = globalMinutes;
+    counter6s = _6sCounter;
+    date = _date;
+    ticks = READTIMER0();
+    ei();
+
+    if(hours == TIME_NOT_SET || date == DATE_NOT_SET)
+    {
+        _calibrationStarted = false;
+        return;
+    }
+    int32_t errorSec = CalendarToTime(date, hours, minutes, 0) - *masterTime;
+    if(!_calibrationStarted || errorSec > WATCH_CALIBRATION_MAX_ERROR || errorSec < -WATCH_CALIBRATION_MAX_ERROR)
+    {
+        _calibrationStart = *masterTime;
+        _calibrationDriftMs = 0;
+        _calibrationStarted = true;
+        return;
+    }
+    // Milliseconds in current minute: end of current 6 sec period minus ticks left
+    uint16_t ticksLeft = 0 - ticks;
+    int32_t msInMinute = (uint32_t)(counter6s + 1) * 6000 - (uint32_t)ticksLeft * 1000 / WATCH_TIMER_TICKS_IN_1_SEC;
+    _calibrationDriftMs += errorSec * 1000 + msInMinute;
+
+    int32_t interval = *masterTime - _calibrationStart;
+    if(interval < WATCH_CALIBRATION_MIN_INTERVAL)
+        return;
+    if(_calibrationDriftMs < WATCH_CALIBRATION_MAX_DRIFT && _calibrationDriftMs > -WATCH_CALIBRATION_MAX_DRIFT)
+    {
+        // drift per 6 sec period, half of it to smooth second rounding of master time
+        int32_t delta = _calibrationDriftMs * (WATCH_CORRECTION_PER_MS_IN_6S * 6) / interval;
+        SetWatchCorrection(_watchCorrection + (int16_t)(delta / 2));
+        SettingSet(SETTING_WATCH_CORRECTION_LO, LOW_BYTE(_watchCorrection));
+        SettingSet(SETTING_WATCH_CORRECTION_HI, HIGH_BYTE(_watchCorrection));
+    }
+    _calibrationStart = *masterTime;
+    _calibrationDriftMs = 0;
+}
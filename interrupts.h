@@ -32,6 +32,7 @@
 #define	XC_HEADER_TEMPLATE_H
 
 #include <xc.h> // include processor files - each processor file is guarded.  
+#include <time.h>
 
 // TODO Insert appropriate #include <>
 
@@ -63,19 +64,50 @@
 // TODO Insert declarations or function prototypes (right here) to leverage 
 // live documentation
 
+// Size of UART receive slot and Modbus frame buffer
+#define FRAME_SLOT_SIZE 140
+// Contiguous, boot block reuses them as its buffers
+extern uint8_t _frameSlots[2][FRAME_SLOT_SIZE];
 void InitUartBuffer();
-// Bytes in Usart buffer
-uint8_t PortAvailable();
-// Read one byte from buffer
-uint8_t PortRead();
+// Mask low priority interrupts (UART receiver, frame timer). Modbus fast
+// path reads registers there, so 16-bit register is written masked
+#define LowIsrLock() (INTCONbits.GIEL = 0)
+#define LowIsrUnlock() (INTCONbits.GIEL = 1)
+#define ModbusRegWrite(reg, value) do { LowIsrLock(); (reg) = (value); LowIsrUnlock(); } while(0)
+// True when frame ended (T35 silence) and was not answered in interrupt
+bool PortFrameReady();
+// Take received frame, receiver continues in the other slot.
+// Frame stays valid until next PortTakeFrame call
+uint8_t *PortTakeFrame(uint8_t *len, bool *corrupt);
+// Slot returned by last PortTakeFrame
+uint8_t *PortFrameBuffer();
 void PortWriteByte(uint8_t b);
 void PortWrite(uint8_t *buf, uint8_t buflen);
 void PortClearReadBuffer();
+void PortGetErrors(uint8_t *overruns, uint8_t *framingErrors);
 unsigned long millis();
+// Deadlines are checked by CCP2 compare interrupt, no polling of millis()
+#define DEADLINE_SOUND 0
+#define DEADLINE_BLINK 1
+#define DEADLINE_SETTINGS 2
+#define DEADLINES_COUNT 3
+void SetDeadline(uint8_t deadline, unsigned long ms);
+void CancelDeadline(uint8_t deadline);
+// Return true once after deadline passed
+bool DeadlineDue(uint8_t deadline);
 // return true if time set
 bool getHourMin(uint8_t *hour, uint8_t *min);
 bool getTotalMinutes(uint16_t *totalMinutes);
 void SetHourMin(uint8_t *newHour, uint8_t *newMin, uint8_t *sec);
+// Days from 01.01.2000, return true if set
+bool getDate(uint16_t *date);
+void SetDate(uint16_t date);
+// 0 - Monday .. 6 - Sunday, return true if set
+bool getDayOfWeek(uint8_t *dayOfWeek);
+// Learned watch correction, 1/256 timer tick per 6 sec
+int16_t GetWatchCorrection();
+void WatchLoadCorrection();
+void WatchCalibrate(time_t *masterTime);
 
 #ifdef	__cplusplus
 extern "C" {
@@ -28,6 +28,11 @@
 #include "user.h"          /* User funct/params, such as InitApp */
 #include "ModbusRtu.h"  
 #include "interrupts.h"
+#include "flash.h"
+#include "settings.h"
+#include "eventlog.h"
+#include "buttons.h"
+#include "boot.h"
 
 /******************************************************************************/
 /* User Global Variable Declaration                                           */
@@ -53,9 +58,6 @@ bool IsBusserOn = false;
 #define BuzzerOff  0x0
 #define BuzzerOn   0x0F
 
-#define BUTTON_INTRUSION PORTCbits.RC3
-#define BUTTON_RESET PORTCbits.RC1
-
 #define BLINK_DURATION 384
 #define BLINK_PERIOD 576
 
@@ -67,77 +69,60 @@ bool IsBusserOn = false;
 #define MAX_LED_NUM 60
 #define EE_MAX_EVENTS 3
 //#define MAX_LED_FOR_COMMAND 4 // Max led num for lighting from modbus
-#define EE_EVENT_COUNT 10
+#define EE_EVENT_COUNT 10 // 7 bit - events with day mask, 0-6 bits - events count
 #define EE_FIRST_EVENT EE_EVENT_COUNT + 1 // 12 events * 2 bytes = 24 bytes
 
+// Storage addresses below 0x100 - EEPROM, from 0x100 - flash bank (FlashRead)
+#define STORAGE_FLASH_BANK 0x100
+// Flash bank replaces events and sounds in EEPROM if starts with signature
+// 0 - signature, 1 - event count, then events, sound count,
+// sound addresses (HI, LO), sounds data - same as in EEPROM
+#define FLASH_BANK_SIGNATURE 0xC2
+#define FLASH_BANK_EVENT_COUNT (STORAGE_FLASH_BANK + 1)
+
+#define EVENTS_WITH_DAY_MASK 0x80
+#define EVENT_RECORD_SIZE 2
+#define EVENT_RECORD_WITH_DAY_MASK_SIZE 3
+
 // Sounds
 //#define EE_SOUNDS_COUNT 40
 
 #define PLAY_INFINITE USHRT_MAX
 
-#define DISCRETE_REG_TIME_SET 0
-#define DISCRETE_REG_NEED_TIME_SYNC 1
+#define SOUND_FORMAT_LEGACY 0x00
+#define SOUND_FORMAT_COMPACT 0x80 // Sound header: bit 7 - compact format, 0-6 bits - encoded length
 
+#define SOUND_CODE_END 0x00
+#define SOUND_CODE_LOOP_START 0x08
+#define SOUND_LOOP_IDLE 0xFF
 
-#define COIL_FIRE 0x00 // FIre alarm
-#define COIL_WARNING 0x01 // Warning alarm
-#define COIL_ALARM 0x02 // Alarm!
-#define COIL_ASSAULT 0x03 // Assault
-#define COIL_NOT_RESPONSE 0x04 // NotResponse
-#define COIL_BLOCKING 0x05 // Blicking
-#define COIL_FAULT 0x06 // Fault
-#define COIL_WORKING 0x07 // Working
+// Sound request sources
+#define SOUND_SRC_DIARY 0x00
+#define SOUND_SRC_COMMAND_LED 0x01
+#define SOUND_SRC_COMMAND 0x02
+#define SOUND_SRC_STATUS_LED 0x08 // + status led row
 
-//  #define COIL_BUTTON_PRESSED 0x08 // When Reset Button Pressed
-#define COIL_CLEAR_ALL_EVENTS 0x09 // Clear diary
+// Sound request priorities, higher plays first
+#define SOUND_PRIORITY_INFO 1
+#define SOUND_PRIORITY_DIARY 2
+#define SOUND_PRIORITY_COMMAND_LED 3
+#define SOUND_PRIORITY_STATUS 4
+#define SOUND_PRIORITY_WARNING 5
+#define SOUND_PRIORITY_ALARM 6
+#define SOUND_PRIORITY_FIRE 7
 
+#define SOUND_QUEUE_LEN 4
+#define SOUND_REQUEST_NONE 0xFF
 
-//#define RESET_COIL 0x0f // When set< reset controller
-
-//#define INPUT_REG_LAST_COMMAND_STATE 0 // State after execution last command 0x8080 - All Right
-#define INPUT_REG_CURRENT_HOUR_MIN 1
-#define INPUT_REG_EVENT_OLD_CUR_NUM 2
-#define INPUT_REG_EVENT_HOUR_MIN 3
-#define INPUT_REG_CURRENT_HOUR_MIN_2 4
-#define INPUT_REG_SECONDS 5
-#define INPUT_REG_SOUND_CNT_EVENT_COUNT 6
-#define INPUT_REG_PL_LEN_POS_IN_EE 7
-
-#define INPUT_REG_TOTAL_MINUTES 8
-
-
-//#define HOLDING_REG_SETLED 0 // Set led stste HI - Led number [1..60] Lo - state 
-//#define HOLDING_BUZZER_LOUD_QUIET_DURATION 1 // Day|Evening buzzer duration
-//#define HOLDING_BUZZER_INFO_ALARM_PERIOD 2 // HI - Info Period, LO - Alarm period
-//#define HOLDING_BUZZER_ON_OFF_DURATION_PERIOD 3 // * 256 ms
-
-#define HOLDING_EVENT_ACCEPT_TIME_S 4  // Time to react to the event in sec
-
-#define HOLDING_BUZZER_ESCALADE 5 // HI - Time from start playing to full loud, LO - Start duration divider(Duration >> x)
-
-#define HOLDING_EVENING_MORNING_TIME_HOUR 6 // Quiet buzzer|Loud buzzer start
-#define HOLDING_NIGHT_START_END_HOUR 7 // Mute buzzer|Quiet buzzer
-
-#define HOLDING_BLINK_DURATION_PERIOD 8 // HI - duration, ms << 6, LO - Period, ms << 6
-
-//#define HOUR_MIN_HOLDING_REG 9
-//#define DAY_SEC_HOLDING_REG 10
-//#define YEAR_MONTH_HOLDING_REG 11
-
-//#define HOLDING_ADD_EVENT 13 // HI: 5 bit - alarm(1) | info(0),  0-4 bits - hour | LO: minute
-
+#define DISCRETE_REG_TIME_SET 0
+#define DISCRETE_REG_NEED_TIME_SYNC 1
 
-// Custom Commands
-#define MB_COMMAND_CLEAR_ALL_EVENTS 0x80
-//#define MB_COMMAND_ADD_EVENT 0x81
-#define MB_COMMAND_SET_LED 0x82
-#define MB_COMMAND_SET_STATUS_LED 0x83 // Data - HighBit - On/Off, low 3 bits: FIRE, WARNING, Alarm, Napadeniye, NOT_RESPONSE
-// Additional: HI - sound Id, LO playDuration * 256msec 0 - once
 
+// Coils, input and holding registers are described by tables in user.h
 
+//#define RESET_COIL 0x0f // When set< reset controller
 
-//#define MB_COMMAND_TEST_SOUND 0x90 // Play sound 2 seconds LO: Period, Additional: duration (10 bit))
-#define MB_COMMAND_PLAY_SOUND_NUM 0x91 // Data - sound id, additional data - s
+// Custom Commands are in ModbusRtu.h, batch needs their sizes
 
 #define D7CLC_PIN RC1
 
@@ -173,8 +158,11 @@ bool IsBusserOn = false;
 */
 uint16_t modbusState;
 
-uint8_t _eeFirstSoundAddress;
-uint8_t _eeSoundAddressesList;
+uint16_t _firstSoundAddress;
+uint16_t _soundAddressesList;
+uint8_t _soundAddressSize = 1; // 2 in flash bank
+uint16_t _eventCountAddress = EE_EVENT_COUNT;
+uint16_t _storageEnd = SETTINGS_JOURNAL_START;
 uint8_t _maxDiaryEvents;
 
 //uint16_t buzzerOnOffDuration = 0x100; // 256 ms
@@ -192,6 +180,9 @@ uint8_t eventAcceptTime;
 //uint8_t morningTimeHour;
 
 uint8_t eventCount;
+uint8_t _eventRecordSize = EVENT_RECORD_SIZE;
+uint8_t _eventOrder[MAX_LED_NUM]; // Event numbers sorted by time
+uint8_t _eventOrderLen = 0;
 //uint8_t currentEvent = 0;
 //uint16_t currentEventMinetesFromMidnight = 0; // Minutes when event signal
 //uint8_t currentEventType = 0; // Alarm(1) Info(0)
@@ -206,9 +197,14 @@ uint8_t eventCount;
 
 bool _isSoundPlaying = false;
 uint8_t _soundCount = 0;
-uint8_t _playingSoundSteps = 0;
-uint8_t _playingSoundStartPosInEe = 0;
+uint8_t _playingSoundFormat = 0;
+uint8_t _playingSoundSteps = 0; // steps in legacy format, encoded bytes in compact
+uint16_t _playingSoundStartPos = 0;
 uint8_t _playingSoundCurPos = 0;
+uint8_t _soundLastCode = 0; // last played compact note step
+uint8_t _soundRepeatLeft = 0;
+uint8_t _soundLoopPos = 0;
+uint8_t _soundLoopLeft = SOUND_LOOP_IDLE;
 
 uint8_t _nextEventSoundId = 0;
 uint16_t _nextEventPlayDuration = 0;
@@ -220,6 +216,17 @@ uint16_t _nextEventPlayDuration = 0;
 // diagnose and test
 time_t soundTestEnd = 0; // Absolute second? before? to reset event
 
+typedef struct 
+{
+    uint8_t SoundId; // SOUND_REQUEST_NONE - free slot
+    uint8_t Priority;
+    uint8_t Source;
+    time_t EndSecond; // 0 - once, ULONG_MAX - infinite
+}SoundRequest;
+
+SoundRequest _soundQueue[SOUND_QUEUE_LEN];
+uint8_t _playingRequest = SOUND_REQUEST_NONE;
+
 // Minutes from midnight
 //uint16_t *minutes;// = MINUTES_NOT_SET;
 
@@ -275,13 +282,26 @@ typedef struct
 EventFromCommand _eventFromCommand;
 
 void io_poll();
+void ProcessUserCommands();
+void ProcessButtonEvent(uint8_t event);
+void CoilsWritten(uint16_t dirty);
+void HoldingRegsWritten(uint32_t dirty);
+void CommitHoldingRegs();
+void SoundRequestDone();
+void StopPlaying();
+void RestartPlaying();
 void SetTimeFromRegs(uint16_t *hourMin, uint16_t *daySec, uint16_t *yearMonth);
 void LoadNextEvent();
+void BuildEventIndex();
+uint16_t EventRecordAddress(uint8_t eventNum);
+uint16_t SoundHeaderAddress(uint8_t soundId);
+uint16_t SoundDataLength(uint8_t soundHeader);
 typedef enum  {LED_OFF, LED_GREEN, LED_RED, LED_ORANGE} LED_STATES;
 
 
 void UpdateLedRegister(uint8_t regIndex)
 {
+    ButtonsLatchBegin();
     switch(regIndex)
     {
         case 0: // D3
@@ -309,6 +329,22 @@ void UpdateLedRegister(uint8_t regIndex)
             TRISCbits.RC1 = 1; 
             break;
     }
+    ButtonsLatchEnd();
+}
+
+// Change sequence register lets master skip reading unchanged block.
+// Clock registers are not counted, they change every second
+void ChangeSeqBump()
+{
+    ModbusRegWrite(_MODBUSInputRegs[INPUT_REG_CHANGE_SEQ], _MODBUSInputRegs[INPUT_REG_CHANGE_SEQ] + 1);
+}
+
+void SetInputReg(uint8_t reg, uint16_t value)
+{
+    if(_MODBUSInputRegs[reg] == value)
+        return;
+    ModbusRegWrite(_MODBUSInputRegs[reg], value);
+    ChangeSeqBump();
 }
 
 // Excluding statuses
@@ -319,6 +355,7 @@ void SwitchOffAllLeds()
         ledStatuses[i] = 0;
         ledBlink[i] = 0;
     }
+    ChangeSeqBump();
 }
 
 
@@ -333,6 +370,8 @@ void LightLed(uint8_t ledNum, LED_STATES ledState, bool blink)
     
     uint8_t ststusIndex = ledNum >> 2;
     uint8_t statusShift = (ledNum & 0x03) << 1;
+    uint8_t oldStatus = ledStatuses[ststusIndex];
+    uint8_t oldBlink = ledBlink[ststusIndex];
     
     switch(ledState)
     {
@@ -361,7 +400,8 @@ void LightLed(uint8_t ledNum, LED_STATES ledState, bool blink)
             bitWrite(ledBlink[ststusIndex], statusShift, blink);
             break;    
     }
-    
+    if(ledStatuses[ststusIndex] != oldStatus || ledBlink[ststusIndex] != oldBlink)
+        ChangeSeqBump();
 }
 
 void SwitchOffAllDiaryLeds()
@@ -376,9 +416,13 @@ void LightStatusLed(uint8_t row, bool on, bool blink)
 {
     if(row > 7)
         return;
+    uint8_t oldStatus = ledStatuses[LED_STATUSES_LEN-1];
+    uint8_t oldBlink = ledBlink[LED_STATUSES_LEN-1];
     bitWrite(ledStatuses[LED_STATUSES_LEN-1], row, on);
     bitWrite(ledBlink[LED_STATUSES_LEN-1], row, blink);
     bitWrite(_MODBUSCoils, row, on);
+    if(ledStatuses[LED_STATUSES_LEN-1] != oldStatus || ledBlink[LED_STATUSES_LEN-1] != oldBlink)
+        ChangeSeqBump();
 //    UpdateStatusLeds();
 }
 
@@ -437,21 +481,102 @@ void ShowFailure(uint8_t additionalLed)
     LightLed(additionalLed, LED_RED, true);  
 }
 
-void InitFromEeprom()
+uint8_t StorageRead(uint16_t address)
 {
-    SwitchOffAllLeds();
+    if(address < STORAGE_FLASH_BANK)
+        return SettingGet((uint8_t)address);
+    return FlashRead(address - STORAGE_FLASH_BANK);
+}
 
-    eventAcceptTime         = eeprom_read(EE_EVENT_ACCEPT_TIME);
+// Scalars from settings and holding registers
+void LoadSettings()
+{
+    CommitHoldingRegs(); // registers are reloaded from settings below
+    eventAcceptTime         = SettingGet(EE_EVENT_ACCEPT_TIME);
+    MB_HOLDING_REGS(MB_HOLDING_LOAD)
 //    blinkDuration           = ((uint16_t)_EEREG_EEPROM_READ(EE_BLINK_DURATION)) << 6;
 //    blinkPeriod             = ((uint16_t)_EEREG_EEPROM_READ(EE_BLINK_PERIOD)) << 6;
-    
+}
+
+// Sound count and addresses list, it follows event table
+bool LoadSoundTable()
+{
+    // First 3 sounds - are for diary
+    uint16_t soundCountAddress = EventRecordAddress(eventCount);
+    _soundCount = StorageRead(soundCountAddress);
+    if(_soundCount == 0xFF)
+        _soundCount = 0;
+    else
+    {
+        _soundAddressesList = soundCountAddress + 1;
+        _firstSoundAddress = _soundAddressesList + _soundCount * _soundAddressSize;
+        if(_firstSoundAddress >= _storageEnd)
+        {
+            ShowFailure(5);
+            return false;
+        }
+        // Flash bank written before config staging took its last blocks
+        // is rejected, config upload would overwrite its sounds
+        for(uint8_t i = 0; i < _soundCount; i++)
+        {
+            uint16_t soundHeaderAddress = SoundHeaderAddress(i);
+            if(soundHeaderAddress >= _storageEnd
+                    || soundHeaderAddress + 1 + SoundDataLength(StorageRead(soundHeaderAddress)) >= _storageEnd)
+            {
+                ShowFailure(5);
+                return false;
+            }
+        }
+    }   
+    SetInputReg(INPUT_REG_SOUND_CNT_EVENT_COUNT, word(_soundCount, eventCount));
+    return true;
+}
+
+// Event table from EEPROM or flash bank, sound table moves with it
+bool LoadEventTable()
+{
+    _eventCountAddress = EE_EVENT_COUNT;
+    _soundAddressSize = 1;
+    _storageEnd = SETTINGS_JOURNAL_START;
+    if(FlashRead(0) == FLASH_BANK_SIGNATURE)
+    {
+        _eventCountAddress = FLASH_BANK_EVENT_COUNT;
+        _soundAddressSize = 2;
+        _storageEnd = STORAGE_FLASH_BANK + FLASH_STORAGE_SIZE;
+    }
+    eventCount = StorageRead(_eventCountAddress);
+    if(eventCount == 0xff)
+        eventCount = 0;
+    _eventRecordSize = EVENT_RECORD_SIZE;
+    if(eventCount & EVENTS_WITH_DAY_MASK)
+    {
+        _eventRecordSize = EVENT_RECORD_WITH_DAY_MASK_SIZE;
+        eventCount &= ~EVENTS_WITH_DAY_MASK;
+    }
+    if(eventCount > _maxDiaryEvents)
+    {
+        ShowFailure(3);
+        return false;
+    }    
+//    SetBuzzerDuty(buzzeLoudDuration); //!!!!!
+//    PR2 = buzzerAlarmPeriod;
+    return LoadSoundTable();
+}
+
+void InitFromEeprom()
+{
+    SwitchOffAllLeds();
+    StopPlaying(); // Sound table may be changed
+    _eventOrderLen = 0;
+
+    LoadSettings();
 //    uint8_t tmpModbusId = _EEREG_EEPROM_READ(EE_MODBUS_ID);
 //    if(tmpModbusId == 0xff)
 //        tmpModbusId = DEFAULT_MODBUS_ID;
     Modbus(0, 0);
    
     
-    _maxDiaryEvents = eeprom_read(EE_MAX_EVENTS);
+    _maxDiaryEvents = SettingGet(EE_MAX_EVENTS);
     if(_maxDiaryEvents == 0xff)
         _maxDiaryEvents = 0;
     if(_maxDiaryEvents > MAX_LED_NUM)
@@ -459,34 +584,8 @@ void InitFromEeprom()
         ShowFailure(2);
         return;
     }
-    eventCount = eeprom_read(EE_EVENT_COUNT);
-    if(eventCount == 0xff)
-        eventCount = 0;
-    if(eventCount > _maxDiaryEvents)
-    {
-        ShowFailure(3);
+    if(!LoadEventTable())
         return;
-    }    
-//    SetBuzzerDuty(buzzeLoudDuration); //!!!!!
-//    PR2 = buzzerAlarmPeriod;
-    
-    // First 3 sounds - are for diary
-    uint8_t eeSoundCountAddress = EE_FIRST_EVENT + eventCount * 2;    
-    _soundCount = eeprom_read(eeSoundCountAddress);
-    if(_soundCount == 0xFF)
-        _soundCount = 0;
-    else
-    {
-        _eeSoundAddressesList = eeSoundCountAddress + 1;
-        _eeFirstSoundAddress = _eeSoundAddressesList + _soundCount;
-        if(_eeFirstSoundAddress >= _EEPROMSIZE)
-        {
-            ShowFailure(5);
-            return;
-        }
-    }   
-    _MODBUSInputRegs[INPUT_REG_SOUND_CNT_EVENT_COUNT] = word(_soundCount, eventCount);
-    
 
     _eventFromCommand.IsFire = false;
     
@@ -496,6 +595,7 @@ void InitFromEeprom()
     _currenDiaryEvent.FiredEventNum = 0xff;
     _currenDiaryEvent.NextEventNum = 0xff;
     //currentAlarmedEventNum = 0xff;
+    BuildEventIndex();
     LoadNextEvent();
     
     
@@ -503,6 +603,48 @@ void InitFromEeprom()
     //_MODBUSInputRegs[INPUT_REG_SOUND_LEN_IS_PLAYING] = word(_soundCount, _isSoundPlaying);
 }
 
+// Event or sound table changed. LEDs, fired events and sound requests
+// are kept, sound data under the player may be changed, so it restarts
+void ReloadTables(bool events)
+{
+    if(events)
+    {
+        _eventOrderLen = 0;
+        if(!LoadEventTable())
+        {
+            StopPlaying();
+            return;
+        }
+        BuildEventIndex();
+        LoadNextEvent();
+    }
+    else if(!LoadSoundTable())
+    {
+        StopPlaying();
+        return;
+    }
+    RestartPlaying();
+}
+
+// Reload only what EEPROM bytes first..last hold. Max events moves diary
+// LEDs, only it needs full reload
+void ReloadEepromRange(uint16_t first, uint16_t last)
+{
+    if(first <= EE_MAX_EVENTS && last >= EE_MAX_EVENTS)
+    {
+        InitFromEeprom();
+        return;
+    }
+    if(first <= SETTING_MODBUS_ID && last >= SETTING_MODBUS_ID)
+        ModbusLoadID();
+    if(first <= EE_EVENT_ACCEPT_TIME && last >= EE_EVENT_ACCEPT_TIME)
+        LoadSettings();
+    // Tables in flash bank do not use EEPROM
+    if(_eventCountAddress >= STORAGE_FLASH_BANK || last < _eventCountAddress)
+        return;
+    ReloadTables(first <= EventRecordAddress(eventCount));
+}
+
 uint8_t GetCurrentEventDiodeNum()
 {
     return MAX_LED_NUM - _maxDiaryEvents + _currenDiaryEvent.FiredEventNum + 1;
@@ -517,21 +659,16 @@ uint8_t GetCurrentEventDiodeNum()
 
 
 uint8_t currentLedBlock = 0;
-unsigned long diffTime;
-unsigned long oldBlinkOnTime = 0;
+unsigned long _blinkNextMs = 0;
 bool blinkOn = false;
 
-void ProcessLightBlock(unsigned long *curMs)
+void ProcessLightBlock()
 {
-    diffTime = *curMs - oldBlinkOnTime;
-    if(diffTime > BLINK_PERIOD)
-    {
-        blinkOn = true;
-        oldBlinkOnTime = *curMs;
-    }
-    else if(blinkOn && diffTime > BLINK_DURATION)
+    if(DeadlineDue(DEADLINE_BLINK))
     {
-        blinkOn = false;
+        blinkOn = !blinkOn;
+        _blinkNextMs += blinkOn ? BLINK_DURATION : BLINK_PERIOD - BLINK_DURATION;
+        SetDeadline(DEADLINE_BLINK, _blinkNextMs);
     }
 
     // Off all LED common wires
@@ -585,107 +722,403 @@ void ProcessLightBlock(unsigned long *curMs)
 #define IsNowNightTime(hour) (hour >= nightStartHour && hour < nightEndHour)
 
 
-unsigned long _playingEndMs = 0;
-
+void UpdateSoundState()
+{
+    uint8_t activeCount = 0;
+    for(uint8_t i = 0; i < SOUND_QUEUE_LEN; i++)
+    {
+        if(_soundQueue[i].SoundId != SOUND_REQUEST_NONE)
+            activeCount++;
+    }
+    if(_playingRequest == SOUND_REQUEST_NONE)
+    {
+        SetInputReg(INPUT_REG_SOUND_PLAYING, word(SOUND_REQUEST_NONE, 0));
+        SetInputReg(INPUT_REG_SOUND_QUEUE, word(SOUND_REQUEST_NONE, activeCount));
+        return;
+    }
+    SoundRequest *request = &_soundQueue[_playingRequest];
+    SetInputReg(INPUT_REG_SOUND_PLAYING, word(request->SoundId, request->Priority));
+    SetInputReg(INPUT_REG_SOUND_QUEUE, word(request->Source, activeCount));
+}
 
+// Stop sound and clear all requests
 void StopPlaying()
 {
     _isSoundPlaying = false;
+    CancelDeadline(DEADLINE_SOUND);
     StopBuzzer;
-    
-//    _MODBUSInputRegs[INPUT_REG_SOUND_LEN_IS_PLAYING] = word(_soundCount, _isSoundPlaying);
+    for(uint8_t i = 0; i < SOUND_QUEUE_LEN; i++)
+        _soundQueue[i].SoundId = SOUND_REQUEST_NONE;
+    _playingRequest = SOUND_REQUEST_NONE;
+    UpdateSoundState();
+}
+
+// PR2 values for compact sounds notes 1..15: C6..C8 (prescaler 16)
+const uint8_t SoundNotePeriods[15] = {148, 132, 118, 111, 99, 88, 78, 74, 66, 58, 55, 49, 43, 39, 36};
+
+// duration - * 64 ms, period or duty == 0 : silence
+void SoundStartStep(uint8_t duration, uint8_t period, uint16_t duty)
+{
+    uint16_t stepDuration = duration;
+    stepDuration <<= 6; // * 64
+    SetDeadline(DEADLINE_SOUND, millis() + stepDuration);
+    if(duty == 0 || period == 0)
+    {
+        StopBuzzer;
+        return;
+    }
+    PR2 = period;
+    SetBuzzerDuty(duty);
+    StartBuzzer;
+}
+
+void SoundRewind()
+{
+    _playingSoundCurPos = 0;
+    _soundLastCode = 0;
+    _soundRepeatLeft = 0;
+    _soundLoopLeft = SOUND_LOOP_IDLE;
+}
+
+// Decode compact sound until next note step and start it
+// return false if end of sound reached
+bool SoundCompactNextStep()
+{
+    uint8_t code;
+    if(_soundRepeatLeft > 0)
+    {
+        _soundRepeatLeft--;
+        code = _soundLastCode;
+    }
+    else
+    {
+        while(1)
+        {
+            if(_playingSoundCurPos >= _playingSoundSteps)
+                return false;
+            code = StorageRead(_playingSoundStartPos + _playingSoundCurPos);
+            _playingSoundCurPos++;
+            if(code & 0xF0) // Note step
+                break;
+            if(code == SOUND_CODE_END)
+                return false;
+            if(code < SOUND_CODE_LOOP_START) // Repeat previous step
+            {
+                if(_soundLastCode == 0)
+                    continue;
+                _soundRepeatLeft = code - 1;
+                code = _soundLastCode;
+                break;
+            }
+            if(code == SOUND_CODE_LOOP_START)
+            {
+                _soundLoopPos = _playingSoundCurPos;
+                _soundLoopLeft = SOUND_LOOP_IDLE;
+                continue;
+            }
+            // Loop end: jump to loop start (code & 0x07) times
+            if(_soundLoopLeft == SOUND_LOOP_IDLE)
+                _soundLoopLeft = code & 0x07;
+            if(_soundLoopLeft > 0)
+            {
+                _soundLoopLeft--;
+                _playingSoundCurPos = _soundLoopPos;
+            }
+            else
+                _soundLoopLeft = SOUND_LOOP_IDLE;
+        }
+    }
+    _soundLastCode = code;
+    uint8_t note = code & 0x0F;
+    if(note == 0)
+    {
+        SoundStartStep(code >> 4, 0, 0);
+        return true;
+    }
+    uint8_t period = SoundNotePeriods[note - 1];
+    SoundStartStep(code >> 4, period, ((uint16_t)period + 1) << 1); // 50% duty
+    return true;
 }
 
 void SoundPlayNextStep()
 {
+    if(_playingSoundFormat == SOUND_FORMAT_COMPACT)
+    {
+        if(SoundCompactNextStep())
+            return;
+        if(*GetTime() >= soundTestEnd)
+        {
+            SoundRequestDone();
+            return;
+        }
+        SoundRewind();
+        if(!SoundCompactNextStep())
+            SoundRequestDone();
+        return;
+    }
+    
     if(_playingSoundCurPos >= _playingSoundSteps)
     {
         _playingSoundCurPos = 0;
         if(*GetTime() >= soundTestEnd)
         {
-            StopPlaying();
+            SoundRequestDone();
             return;
         }
     }
-    uint16_t stepDuty = eeprom_read(_playingSoundStartPosInEe + _playingSoundCurPos * 3);
-    stepDuty <<= 6; // * 64
-    _playingEndMs = millis() + stepDuty;
-    PR2 = eeprom_read(_playingSoundStartPosInEe + _playingSoundCurPos * 3 + 1);
-    uint8_t duration = eeprom_read(_playingSoundStartPosInEe + _playingSoundCurPos * 3 + 2);
+    uint16_t stepPos = _playingSoundStartPos + _playingSoundCurPos * 3;
     _playingSoundCurPos++;        
-    if(duration == 0 || PR2 == 0)
-    {
-        StopBuzzer;
-        return;
-    }
-    SetBuzzerDuty(duration);
-    StartBuzzer;
+    SoundStartStep(StorageRead(stepPos), StorageRead(stepPos + 1), StorageRead(stepPos + 2));
 }
 
 /*
  * 0 - sound count
- * 1..N - sound addresses
+ * 1..N - sound addresses from first sound, HI and LO in flash bank
  * N+1..M - sounds data
  * 
  *  Sound data:
- *  0 - sound len
+ *  0 - sound header
+ *      7 bit == 0: legacy format, 0-6 bits - steps count
  *  1..K - sound aequense
- *      0 - play time (ms << 8)
+ *      0 - play time (ms << 6)
  *      1 - period
  *      2 - duration
  *      
  *      period or duration == 0 : silense
  * 
+ *      7 bit == 1: compact format, 0-6 bits - encoded bytes count
+ *  1..K - codes
+ *      HI != 0: HI - play time (ms << 6), LO - note: 0 - silense, 1..15 - SoundNotePeriods
+ *      0x00 - end of sound
+ *      0x01..0x07 - repeat previous step N times
+ *      0x08 - loop start
+ *      0x09..0x0F - jump to loop start (N & 0x07) times
+ * 
  */
 
+// Storage address of sound header
+uint16_t SoundHeaderAddress(uint8_t soundId)
+{
+    uint16_t soundAddrPos = _soundAddressesList + soundId * _soundAddressSize;
+    uint16_t soundAddr = StorageRead(soundAddrPos);
+    if(_soundAddressSize == 2)
+        soundAddr = word(soundAddr, StorageRead(soundAddrPos + 1));
+    return _firstSoundAddress + soundAddr;
+}
+
+// Bytes of sound steps after header
+uint16_t SoundDataLength(uint8_t soundHeader)
+{
+    uint16_t soundLen = soundHeader & ~SOUND_FORMAT_COMPACT;
+    if((soundHeader & SOUND_FORMAT_COMPACT) == SOUND_FORMAT_LEGACY)
+        soundLen *= 3;
+    return soundLen;
+}
+
+// Start request sound from the beginning
+bool SoundStart(SoundRequest *request)
+{
+    uint16_t soundHeaderAddress = SoundHeaderAddress(request->SoundId);
+    if(soundHeaderAddress >= _storageEnd)
+        return false;
+    
+    uint8_t soundHeader = StorageRead(soundHeaderAddress);
+    uint8_t soundFormat = soundHeader & SOUND_FORMAT_COMPACT;
+    uint8_t soundSteps = soundHeader & ~SOUND_FORMAT_COMPACT;
+    uint16_t soundStart = soundHeaderAddress + 1;
+    if(soundStart + SoundDataLength(soundHeader) >= _storageEnd)
+        return false;
+    
+    soundTestEnd = request->EndSecond;
+    _playingSoundFormat = soundFormat;
+    _playingSoundSteps = soundSteps;
+    _playingSoundStartPos = soundStart;
+    SetInputReg(INPUT_REG_PL_LEN_POS_IN_EE, word(soundHeader, (uint8_t)_playingSoundStartPos));
+    
+    SoundRewind();
+    _isSoundPlaying = true;
+    SoundPlayNextStep();
+    return true;
+}
+
+// Play the highest priority request. preferred - wins if priorities are equal
+void SoundArbitrate(uint8_t preferred)
+{
+    time_t now = *GetTime();
+    while(1)
+    {
+        uint8_t best = preferred;
+        if(best == SOUND_REQUEST_NONE)
+            best = _playingRequest;
+        for(uint8_t i = 0; i < SOUND_QUEUE_LEN; i++)
+        {
+            SoundRequest *request = &_soundQueue[i];
+            if(request->SoundId == SOUND_REQUEST_NONE)
+                continue;
+            // Timed request expired while waiting
+            if(i != _playingRequest && request->EndSecond != 0 && request->EndSecond <= now)
+            {
+                request->SoundId = SOUND_REQUEST_NONE;
+                if(best == i)
+                    best = SOUND_REQUEST_NONE;
+                continue;
+            }
+            if(best == SOUND_REQUEST_NONE || request->Priority > _soundQueue[best].Priority)
+                best = i;
+        }
+        if(best == SOUND_REQUEST_NONE)
+        {
+            _isSoundPlaying = false;
+            CancelDeadline(DEADLINE_SOUND);
+            StopBuzzer;
+            _playingRequest = SOUND_REQUEST_NONE;
+            break;
+        }
+        if(best == _playingRequest)
+            break;
+        _playingRequest = best;
+        if(SoundStart(&_soundQueue[best]))
+            break;
+        // Bad sound
+        _soundQueue[best].SoundId = SOUND_REQUEST_NONE;
+        _playingRequest = SOUND_REQUEST_NONE;
+        preferred = SOUND_REQUEST_NONE;
+    }
+    UpdateSoundState();
+}
+
+// Playing request finished, resume the next one
+void SoundRequestDone()
+{
+    if(_playingRequest != SOUND_REQUEST_NONE)
+        _soundQueue[_playingRequest].SoundId = SOUND_REQUEST_NONE;
+    _playingRequest = SOUND_REQUEST_NONE;
+    SoundArbitrate(SOUND_REQUEST_NONE);
+}
+
+// Sound table reloaded. Requests for sounds that are gone are dropped,
+// the playing one starts again from its beginning
+void RestartPlaying()
+{
+    uint8_t playing = _playingRequest;
+    _playingRequest = SOUND_REQUEST_NONE;
+    for(uint8_t i = 0; i < SOUND_QUEUE_LEN; i++)
+    {
+        if(_soundQueue[i].SoundId != SOUND_REQUEST_NONE && _soundQueue[i].SoundId >= _soundCount)
+            _soundQueue[i].SoundId = SOUND_REQUEST_NONE;
+    }
+    if(playing != SOUND_REQUEST_NONE && _soundQueue[playing].SoundId == SOUND_REQUEST_NONE)
+        playing = SOUND_REQUEST_NONE;
+    SoundArbitrate(playing);
+}
+
+// Remove all requests from source
+void StopSound(uint8_t source)
+{
+    bool wasPlaying = false;
+    for(uint8_t i = 0; i < SOUND_QUEUE_LEN; i++)
+    {
+        if(_soundQueue[i].SoundId == SOUND_REQUEST_NONE || _soundQueue[i].Source != source)
+            continue;
+        _soundQueue[i].SoundId = SOUND_REQUEST_NONE;
+        if(i == _playingRequest)
+            wasPlaying = true;
+    }
+    if(wasPlaying)
+    {
+        _playingRequest = SOUND_REQUEST_NONE;
+        SoundArbitrate(SOUND_REQUEST_NONE);
+    }
+    else
+        UpdateSoundState();
+}
+
 // playDuration : 0 - once
 // ff - infinite
 // sec
-bool PlaySound(uint8_t soundId, uint16_t playDuration)
+// Request from the same source replaces the previous one
+bool PlaySound(uint8_t soundId, uint16_t playDuration, uint8_t priority, uint8_t source)
 {
     if(soundId >= _soundCount)
         return false;
     
+    uint8_t slot = SOUND_REQUEST_NONE;
+    for(uint8_t i = 0; i < SOUND_QUEUE_LEN; i++)
+    {
+        if(_soundQueue[i].SoundId != SOUND_REQUEST_NONE && _soundQueue[i].Source == source)
+        {
+            slot = i;
+            break;
+        }
+    }
+    if(slot == SOUND_REQUEST_NONE)
+    {
+        // Free slot or the lowest priority one
+        uint8_t lowest = 0;
+        for(uint8_t i = 0; i < SOUND_QUEUE_LEN; i++)
+        {
+            if(_soundQueue[i].SoundId == SOUND_REQUEST_NONE)
+            {
+                slot = i;
+                break;
+            }
+            if(_soundQueue[i].Priority < _soundQueue[lowest].Priority)
+                lowest = i;
+        }
+        if(slot == SOUND_REQUEST_NONE)
+        {
+            if(_soundQueue[lowest].Priority >= priority)
+                return false;
+            slot = lowest;
+        }
+    }
+    
+    SoundRequest *request = &_soundQueue[slot];
+    request->SoundId = soundId;
+    request->Priority = priority;
+    request->Source = source;
     if(playDuration == 0)
-        soundTestEnd = 0;
+        request->EndSecond = 0;
     else if(playDuration == PLAY_INFINITE)
-        soundTestEnd = ULONG_MAX;
+        request->EndSecond = ULONG_MAX;
     else 
-        soundTestEnd = *GetTime() + playDuration;
-    
-    uint8_t soundAddr = eeprom_read(_eeSoundAddressesList + soundId);
-    if(_eeFirstSoundAddress + soundAddr >= _EEPROMSIZE)
-        return false;
-    
-    _playingSoundSteps = eeprom_read(_eeFirstSoundAddress + soundAddr); // * 3 bytes
-    
-    _playingSoundStartPosInEe = _eeFirstSoundAddress + soundAddr + 1;
-    _MODBUSInputRegs[INPUT_REG_PL_LEN_POS_IN_EE] = word(_playingSoundSteps, _playingSoundStartPosInEe);
-    if(_playingSoundStartPosInEe + _playingSoundSteps * 3 >= _EEPROMSIZE)
-        return false;
-    
-    _playingSoundCurPos = 0;
-    _isSoundPlaying = true;
-    SoundPlayNextStep();
+        request->EndSecond = *GetTime() + playDuration;
     
-//    _MODBUSInputRegs[INPUT_REG_SOUND_LEN_IS_PLAYING] = word(_soundCount, _isSoundPlaying);
+    // Replaced request restarts
+    if(slot == _playingRequest)
+        _playingRequest = SOUND_REQUEST_NONE;
+    SoundArbitrate(slot);
     
     return true;
 }
 
-
+uint8_t StatusSoundPriority(uint8_t row)
+{
+    switch(row)
+    {
+        case LED_STATUS_FIRE:
+            return SOUND_PRIORITY_FIRE;
+        case LED_STATUS_ALARM:
+        case LED_STATUS_ASSAULT:
+            return SOUND_PRIORITY_ALARM;
+        case LED_STATUS_WARNING:
+            return SOUND_PRIORITY_WARNING;
+    }
+    return SOUND_PRIORITY_STATUS;
+}
 
 // state: true - user pressed reset button
 void ResetEvent(bool state)
 {
     if(!_currenDiaryEvent.IsFire)
         return;
+    EventLogAdd(state ? EVENT_LOG_DIARY_RESET : EVENT_LOG_DIARY_TIMEOUT, _currenDiaryEvent.FiredEventNum, *GetTime());
     LightLed(GetCurrentEventDiodeNum(), state ? LED_GREEN : LED_RED, false);  
     _currenDiaryEvent.IsFire = false;
     _currenDiaryEvent.FiredEventNum = 0xff;
     _currenDiaryEvent.ResetSecond = 0;
-    StopPlaying();
-    _MODBUSInputRegs[INPUT_REG_EVENT_OLD_CUR_NUM] = word(_currenDiaryEvent.FiredEventNum, _currenDiaryEvent.NextEventNum);
+    StopSound(SOUND_SRC_DIARY);
+    SetInputReg(INPUT_REG_EVENT_OLD_CUR_NUM, word(_currenDiaryEvent.FiredEventNum, _currenDiaryEvent.NextEventNum));
     
     //curEventProcessState = CUR_EVENT_NOT_PROCESSED;
 }
@@ -694,79 +1127,123 @@ void ResetEventFromCommand(bool state)
 {
     if(!_eventFromCommand.IsFire)
         return;
+    EventLogAdd(state ? EVENT_LOG_COMMAND_LED_RESET : EVENT_LOG_COMMAND_LED_TIMEOUT, _eventFromCommand.LedNum, *GetTime());
     LightLed(_eventFromCommand.LedNum, state ? LED_GREEN : LED_RED, false); 
     _eventFromCommand.IsFire = false;
     _eventFromCommand.ResetSecond = 0;
-    StopPlaying();
+    StopSound(SOUND_SRC_COMMAND_LED);
+}
+
+// Event record: 2 bytes or 3 bytes if EVENTS_WITH_DAY_MASK
+// HI: 5-7 - alarmDuration, 0-4 bits - hour | LO: 6-7 soundId 0-5 minute
+// Day mask: 0 bit - Monday .. 6 bit - Sunday
+uint16_t EventRecordAddress(uint8_t eventNum)
+{
+    return _eventCountAddress + 1 + eventNum * _eventRecordSize;
+}
+
+uint16_t ReadEventMinutes(uint8_t eventNum)
+{
+    uint16_t address = EventRecordAddress(eventNum);
+    uint8_t hour = StorageRead(address) & 0x1F;
+    uint8_t minute = StorageRead(address + 1) & 0x3F;
+    return hour * 60 + minute;
+}
+
+// Sort today events numbers by time, uploaded events may be unordered
+// Call on load, time set and at midnight
+void BuildEventIndex()
+{
+    _eventOrderLen = 0;
+    uint8_t dayOfWeek;
+    bool filterByDay = _eventRecordSize == EVENT_RECORD_WITH_DAY_MASK_SIZE && getDayOfWeek(&dayOfWeek);
+    for(uint8_t eventNum = 0; eventNum < eventCount; eventNum++)
+    {
+        if(filterByDay && !bitRead(StorageRead(EventRecordAddress(eventNum) + 2), dayOfWeek))
+            continue;
+        uint16_t minutes = ReadEventMinutes(eventNum);
+        uint8_t pos = _eventOrderLen;
+        while(pos > 0 && ReadEventMinutes(_eventOrder[pos - 1]) > minutes)
+        {
+            _eventOrder[pos] = _eventOrder[pos - 1];
+            pos--;
+        }
+        _eventOrder[pos] = eventNum;
+        _eventOrderLen++;
+    }
 }
 
 void LoadNextEvent()
 {
-    if(eventCount == 0)
-        return;
     uint16_t totalMinutes;
-    if(!getTotalMinutes(&totalMinutes))
+    if(_eventOrderLen != 0 && !getTotalMinutes(&totalMinutes))
         return;
     
-    do
+    // Binary search of the first event later than now
+    uint8_t first = 0;
+    uint8_t last = _eventOrderLen;
+    while(first < last)
     {
-        if(_currenDiaryEvent.NextEventNum == 0xff)
-            _currenDiaryEvent.NextEventNum = 0;
-        else 
-            _currenDiaryEvent.NextEventNum++;    
-        _MODBUSInputRegs[INPUT_REG_EVENT_OLD_CUR_NUM] = word(_currenDiaryEvent.FiredEventNum, _currenDiaryEvent.NextEventNum);
-        if(_currenDiaryEvent.NextEventNum >= eventCount)
-        {
-            _currenDiaryEvent.NextEventNum = 0xff;
-            _currenDiaryEvent.NextEventTotalMinutes = 0;
-            _MODBUSInputRegs[INPUT_REG_EVENT_HOUR_MIN] = 0;            
-            _MODBUSInputRegs[INPUT_REG_EVENT_OLD_CUR_NUM] = word(_currenDiaryEvent.FiredEventNum, _currenDiaryEvent.NextEventNum);
-            return;
-        }
-        // HI: 5-7 - alarmDuration, 0-4 bits - hour | LO: 5-7 soundId 0-5 minute
-        // alarmDuration:
-        // 0 - once
-        // 1 - 10 sec
-        // 2 - 30 sec
-        // 3 - 1 min
-        // 4 - 5 min
-        // 5 - 12 min
-        // 6 - 30 min
-        // 7 - infinite
-        uint8_t v1 = eeprom_read(EE_FIRST_EVENT + _currenDiaryEvent.NextEventNum * 2);
-        _currenDiaryEvent.NextEventTotalMinutes = (v1 & 0x1F) * 60;
-        //curEventType = bitRead(v1, 5);
-        _nextEventPlayDuration = (v1 >> 5);
-        switch(_nextEventPlayDuration)
-        {
-            case 1:
-                _nextEventPlayDuration = 10;
-                break;
-            case 2:
-                _nextEventPlayDuration = 30;
-                break;
-            case 3:
-                _nextEventPlayDuration = 60;
-                break;
-            case 4:
-                _nextEventPlayDuration = 60*5;
-                break;
-            case 5:
-                _nextEventPlayDuration = 60*12;
-                break;
-            case 6:
-                _nextEventPlayDuration = 60*30;
-                break;
-            case 7:
-                _nextEventPlayDuration = PLAY_INFINITE;
-                break;
-        }
-        uint8_t v1 = eeprom_read(EE_FIRST_EVENT + _currenDiaryEvent.NextEventNum * 2 + 1);        
-        _currenDiaryEvent.NextEventTotalMinutes += v1 & 0x3F;
-        _nextEventSoundId = v1 >> 6;
-        
-    }while(_currenDiaryEvent.NextEventTotalMinutes <= totalMinutes);
-    _MODBUSInputRegs[INPUT_REG_EVENT_HOUR_MIN] = _currenDiaryEvent.NextEventTotalMinutes;
+        uint8_t middle = (first + last) >> 1;
+        if(ReadEventMinutes(_eventOrder[middle]) <= totalMinutes)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    // No events today or all passed, event of other day or deleted one
+    // must not stay loaded
+    if(first >= _eventOrderLen)
+    {
+        _currenDiaryEvent.NextEventNum = 0xff;
+        _currenDiaryEvent.NextEventTotalMinutes = 0;
+        SetInputReg(INPUT_REG_EVENT_HOUR_MIN, 0);            
+        SetInputReg(INPUT_REG_EVENT_OLD_CUR_NUM, word(_currenDiaryEvent.FiredEventNum, _currenDiaryEvent.NextEventNum));
+        return;
+    }
+    _currenDiaryEvent.NextEventNum = _eventOrder[first];
+    _currenDiaryEvent.NextEventTotalMinutes = ReadEventMinutes(_currenDiaryEvent.NextEventNum);
+    SetInputReg(INPUT_REG_EVENT_OLD_CUR_NUM, word(_currenDiaryEvent.FiredEventNum, _currenDiaryEvent.NextEventNum));
+    
+    // alarmDuration:
+    // 0 - once
+    // 1 - 10 sec
+    // 2 - 30 sec
+    // 3 - 1 min
+    // 4 - 5 min
+    // 5 - 12 min
+    // 6 - 30 min
+    // 7 - infinite
+    uint16_t address = EventRecordAddress(_currenDiaryEvent.NextEventNum);
+    uint8_t v1 = StorageRead(address);
+    _nextEventPlayDuration = (v1 >> 5);
+    switch(_nextEventPlayDuration)
+    {
+        case 1:
+            _nextEventPlayDuration = 10;
+            break;
+        case 2:
+            _nextEventPlayDuration = 30;
+            break;
+        case 3:
+            _nextEventPlayDuration = 60;
+            break;
+        case 4:
+            _nextEventPlayDuration = 60*5;
+            break;
+        case 5:
+            _nextEventPlayDuration = 60*12;
+            break;
+        case 6:
+            _nextEventPlayDuration = 60*30;
+            break;
+        case 7:
+            _nextEventPlayDuration = PLAY_INFINITE;
+            break;
+    }
+    v1 = StorageRead(address + 1);        
+    _nextEventSoundId = v1 >> 6;
+    
+    SetInputReg(INPUT_REG_EVENT_HOUR_MIN, _currenDiaryEvent.NextEventTotalMinutes);
     
 }
 // Fires every minute
@@ -794,11 +1271,12 @@ void ProcessDiary()
         {
             _currenDiaryEvent.FiredEventNum = _currenDiaryEvent.NextEventNum;
             _currenDiaryEvent.IsFire = true;
+            EventLogAdd(EVENT_LOG_DIARY_FIRED, _currenDiaryEvent.FiredEventNum, *GetTime());
             //curEventProcessState == CUR_EVENT_ALARMED;
             LightLed(GetCurrentEventDiodeNum(), LED_ORANGE, true);  
             if(_nextEventSoundId != 0)
             {
-                PlaySound(_nextEventSoundId - 1, _nextEventPlayDuration);
+                PlaySound(_nextEventSoundId - 1, _nextEventPlayDuration, SOUND_PRIORITY_DIARY, SOUND_SRC_DIARY);
             }
 //            if(curEventType == 0)
 //            {
@@ -812,7 +1290,7 @@ void ProcessDiary()
             
             LoadNextEvent();
         }
-        _MODBUSInputRegs[INPUT_REG_EVENT_OLD_CUR_NUM] = word(_currenDiaryEvent.FiredEventNum, _currenDiaryEvent.NextEventNum);
+        SetInputReg(INPUT_REG_EVENT_OLD_CUR_NUM, word(_currenDiaryEvent.FiredEventNum, _currenDiaryEvent.NextEventNum));
 
     }
 //        
@@ -839,9 +1317,12 @@ void main(void)
     /* Initialize I/O and Peripherals for application */
     InitApp();
 
-    
+    SettingsInit();
+    SettingsStagedApply(); // Commit interrupted by power loss
+    WatchLoadCorrection();
 
     InitFromEeprom();
+    ModbusRegWrite(_MODBUSHoldingRegs[HOLDING_REPLAY_WINDOW_MS], MODBUS_REPLAY_WINDOW_MS);
         
 
     /* TODO <INSERT USER APPLICATION CODE HERE> */
@@ -853,17 +1334,6 @@ void main(void)
     
     
     
-    bool buttonPressed;
-    unsigned long buttonPressedTime;
-
-    uint8_t buttonState = 1;             // the current reading from the input pin
-    uint8_t lastButtonPinState = 1;   // the previous reading from the input pin
-    
-    							 // the following variables are long's because the time, measured in miliseconds,
-							 // will quickly become a bigger number than can be stored in an int.
-    unsigned long lastDebounceTime = 0;  // the last time the output pin was toggled
-    uint8_t debounceDelay = 50;    // the debounce time; increase if the output flickers
-
     
     
     //ledStatuses[0] = 0x15;
@@ -874,69 +1344,24 @@ void main(void)
     //uint16_t lastMinSec = 0; // Secund counter value
     LightStatusLed(LED_STATUS_WORK, true, false);
     LightStatusLed(LED_STATUS_BLOCKING, true, true); // Time not set yet
+    _blinkNextMs = lastMs;
+    SetDeadline(DEADLINE_BLINK, _blinkNextMs);
     while(1)
     {
         unsigned long curMs = millis();
-        ProcessLightBlock(&curMs);
+        ProcessLightBlock();
 
-        if(_isSoundPlaying && curMs >= _playingEndMs)
+        if(_isSoundPlaying && DeadlineDue(DEADLINE_SOUND))
         {
             SoundPlayNextStep();
         }
+        if(DeadlineDue(DEADLINE_SETTINGS))
+            CommitHoldingRegs();
         
-        // read the state of the switch into a local variable:
-        uint8_t buttonPinCurState = BUTTON_RESET;
-        // check to see if you just pressed the button
-        // (i.e. the input went from LOW to HIGH),  and you've waited
-        // long enough since the last press to ignore any noise:
-
-        // If the switch changed, due to noise or pressing:
-        if (buttonPinCurState != lastButtonPinState)
-        {
-            // reset the debouncing timer
-            lastDebounceTime = curMs;
-            lastButtonPinState = buttonPinCurState;
-        }
-        else
-        {
-            if ((curMs - lastDebounceTime) > debounceDelay)
-            {
-                // whatever the reading is at, it's been there for longer
-                // than the debounce delay, so take it as the actual current state:
-
-                // if the button state has changed:
-                if (buttonPinCurState != buttonState) 
-                {
-                    buttonState = buttonPinCurState;
-
-                    //Serial.println(kakPinCurState);
-                    // only toggle the LED if the new button state is LOW
-                    if (buttonState == 0) 
-                    {
-                        buttonPressed = true;
-                        
-                        if(_eventFromCommand.IsFire)
-                        {
-                            ResetEventFromCommand(true);
-                        }
-                        // reset alarmed event
-                        else if(_currenDiaryEvent.IsFire)
-                        {
-                            ResetEvent(true);
-                        }
-                        else
-                        {
-                            StopPlaying();
-                        }
-
-                    }
-                    else
-                    {
-                        buttonPressed = false;
-                    }
-                }            
-            }
-        }
+        uint8_t buttonEvent;
+        if(ButtonTakeEvent(&buttonEvent))
+            ProcessButtonEvent(buttonEvent);
+        SetInputReg(INPUT_REG_BUTTONS, ButtonsState());
         
 /*        if(BUTTON_RESET == 0)
         {
@@ -970,23 +1395,32 @@ void main(void)
                 ResetEvent(false);
             }
             
-            _MODBUSInputRegs[INPUT_REG_SECONDS] = *GetTime();
+            ModbusRegWrite(_MODBUSInputRegs[INPUT_REG_SECONDS], *GetTime());
+            uint8_t overruns, framingErrors;
+            PortGetErrors(&overruns, &framingErrors);
+            SetInputReg(INPUT_REG_UART_ERRORS, word(overruns, framingErrors));
             
             uint16_t totalMinutes;
             if(getTotalMinutes(&totalMinutes) && (oldMinute != totalMinutes))
             {
-                _MODBUSInputRegs[INPUT_REG_TOTAL_MINUTES] = totalMinutes;
+                ModbusRegWrite(_MODBUSInputRegs[INPUT_REG_TOTAL_MINUTES], totalMinutes);
                 uint8_t hour = 0, minute = 0;
                 getHourMin(&hour, &minute);
-                _MODBUSInputRegs[INPUT_REG_CURRENT_HOUR_MIN] = word(hour, minute);
+                ModbusRegWrite(_MODBUSInputRegs[INPUT_REG_CURRENT_HOUR_MIN], word(hour, minute));
+                
+                uint8_t dayOfWeek = 0xFF;
+                getDayOfWeek(&dayOfWeek);
+                ModbusRegWrite(_MODBUSInputRegs[INPUT_REG_DAY_OF_WEEK], dayOfWeek);
+                SetInputReg(INPUT_REG_WATCH_CORRECTION, GetWatchCorrection());
                 
                 // If midnight reset all diodes
                 if(totalMinutes == 0)
                 {
                     SwitchOffAllDiaryLeds(); //TODO process if event alarmed yet
                     _currenDiaryEvent.NextEventNum = 0xff;
+                    BuildEventIndex(); // New day events
                     LoadNextEvent();
-                    _MODBUSInputRegs[INPUT_REG_EVENT_OLD_CUR_NUM] = word(_currenDiaryEvent.FiredEventNum, _currenDiaryEvent.NextEventNum);
+                    SetInputReg(INPUT_REG_EVENT_OLD_CUR_NUM, word(_currenDiaryEvent.FiredEventNum, _currenDiaryEvent.NextEventNum));
                 }
                 oldMinute = totalMinutes;
                 ProcessDiary();
@@ -999,6 +1433,9 @@ void main(void)
         }
         modbusState = ModbusPoll(_MODBUSDiscreteInputs, &_MODBUSCoils, _MODBUSInputRegs, modbusInputBufLen, _MODBUSHoldingRegs, modbusHoldingBufLen);
         io_poll();
+        // One batched command per pass, keeps loop responsive
+        if(ModbusTakeBatchCommand())
+            ProcessUserCommands();
     }
 
 
@@ -1049,7 +1486,7 @@ void CommandSetLed()
     {
         LightLed(led, LED_OFF, false);
         if(soundId != 0xff)
-            StopPlaying();
+            StopSound(SOUND_SRC_COMMAND_LED);
         return;
     }
     //_eventFromCommand
@@ -1062,10 +1499,11 @@ void CommandSetLed()
     {
         _eventFromCommand.LedNum = led;
         _eventFromCommand.IsFire = true;
+        EventLogAdd(EVENT_LOG_COMMAND_LED_FIRED, led, *GetTime());
         _eventFromCommand.ResetSecond = *GetTime() + blinkSeconds;
         LightLed(led, LED_ORANGE, bitRead(commandData, 6));
     }
-    PlaySound(soundId, *ModbusGetUserCommandAdditional1Lo());
+    PlaySound(soundId, *ModbusGetUserCommandAdditional1Lo(), SOUND_PRIORITY_COMMAND_LED, SOUND_SRC_COMMAND_LED);
     ModbusSetExceptionStatusBit(MB_EXCEPTION_LAST_COMMAND_STATE, true);
 }
 
@@ -1082,14 +1520,51 @@ void CommandSetStatusLed()
     {
         LightStatusLed(led, false, false);
         if(soundId != 0xff)
-            StopPlaying();
+            StopSound(SOUND_SRC_STATUS_LED + led);
         return;
     }
     LightStatusLed(led, true, bitRead(commandData, 6));
-    PlaySound(soundId, *ModbusGetUserCommandAdditional1Lo());
+    PlaySound(soundId, *ModbusGetUserCommandAdditional1Lo(), StatusSoundPriority(led), SOUND_SRC_STATUS_LED + led);
     ModbusSetExceptionStatusBit(MB_EXCEPTION_LAST_COMMAND_STATE, true);
 }
 
+// Short or double press resets fired event, command one first.
+// Long press resets both and stops sound
+void ProcessButtonEvent(uint8_t event)
+{
+    uint8_t kind = ButtonEventKind(event);
+    if(ButtonOf(event) == BUTTON_INTRUSION)
+    {
+        EventLogAdd(EVENT_LOG_INTRUSION, kind, *GetTime());
+        return;
+    }
+    EventLogAdd(EVENT_LOG_BUTTON_PRESS, kind, *GetTime());
+    if(kind == BUTTON_EVENT_LONG)
+    {
+        if(_eventFromCommand.IsFire)
+            ResetEventFromCommand(true);
+        if(_currenDiaryEvent.IsFire)
+            ResetEvent(true);
+        StopPlaying();
+        return;
+    }
+    if(_eventFromCommand.IsFire)
+    {
+        ResetEventFromCommand(true);
+    }
+    // reset alarmed event
+    else if(_currenDiaryEvent.IsFire)
+    {
+        ResetEvent(true);
+    }
+    else
+    {
+        StopPlaying();
+    }
+}
+
+// Size of user command packed in FC101 batch: command id, data and
+// additional bytes it uses
 void ProcessUserCommands()
 {
     uint8_t v1;
@@ -1097,9 +1572,7 @@ void ProcessUserCommands()
     {
         case MB_COMMAND_CLEAR_ALL_EVENTS:
             eventCount = 0;
-            eeprom_write(EE_EVENT_COUNT, 0);
-            while(WR)
-                continue;
+            SettingSet(EE_EVENT_COUNT, 0);
             InitFromEeprom();
             ModbusSetExceptionStatusBit(MB_EXCEPTION_LAST_COMMAND_STATE, true);
             break;
@@ -1109,7 +1582,13 @@ void ProcessUserCommands()
 
         case MB_COMMAND_PLAY_SOUND_NUM:                    
             //soundTestEnd = *GetTime() + _MODBUSHoldingRegs[HOLDING_COMMAND_ADDITIONAL_DATA]; 
-            PlaySound(*ModbusGetUserCommandData(), *ModbusGetUserCommandAdditional1Lo());
+            v1 = *ModbusGetUserCommandAdditional1Hi();
+            if(v1 == 0)
+                v1 = SOUND_PRIORITY_INFO;
+            // Master sound must not mask alarm and fire statuses
+            if(v1 > SOUND_PRIORITY_WARNING)
+                v1 = SOUND_PRIORITY_WARNING;
+            PlaySound(*ModbusGetUserCommandData(), *ModbusGetUserCommandAdditional1Lo(), v1, SOUND_SRC_COMMAND);
             break;       
 
         case MB_COMMAND_SET_STATUS_LED:  
@@ -1118,6 +1597,64 @@ void ProcessUserCommands()
     }
 }
 
+void SetEventAcceptTime(uint16_t value)
+{
+    eventAcceptTime = LOW_BYTE(value);
+}
+
+// Handlers are generated from MB_COILS and MB_HOLDING_REGS tables.
+// Only changed addresses are visited, loop ends after last dirty bit
+void CoilsWritten(uint16_t dirty)
+{
+    if(dirty != 0)
+        ChangeSeqBump();
+    for(uint8_t addr = 0; dirty != 0; addr++, dirty >>= 1)
+    {
+        if(!(dirty & 1))
+            continue;
+        switch(addr)
+        {
+            MB_COILS(MB_COIL_WRITTEN)
+        }
+    }
+}
+
+// Settings-backed holding registers changed by master, not saved yet.
+// Writes within SETTINGS_COMMIT_DELAY_MS after first one are saved once
+uint32_t _holdingUncommitted = 0;
+
+void HoldingRegsWritten(uint32_t dirty)
+{
+    bool wasPending = _holdingUncommitted != 0;
+    for(uint8_t addr = 0; dirty != 0; addr++, dirty >>= 1)
+    {
+        if(!(dirty & 1))
+            continue;
+        switch(addr)
+        {
+            MB_HOLDING_REGS(MB_HOLDING_WRITTEN)
+        }
+    }
+    if(!wasPending && _holdingUncommitted != 0)
+        SetDeadline(DEADLINE_SETTINGS, millis() + SETTINGS_COMMIT_DELAY_MS);
+}
+
+void CommitHoldingRegs()
+{
+    uint32_t pending = _holdingUncommitted;
+    _holdingUncommitted = 0;
+    CancelDeadline(DEADLINE_SETTINGS);
+    for(uint8_t addr = 0; pending != 0; addr++, pending >>= 1)
+    {
+        if(!(pending & 1))
+            continue;
+        switch(addr)
+        {
+            MB_HOLDING_REGS(MB_HOLDING_COMMIT)
+        }
+    }
+}
+
 void io_poll() 
 {
     uint16_t lastAddress;
@@ -1136,8 +1673,19 @@ void io_poll()
         if(lastCommand == MB_COMMAND_SET_TIME)
         {
             LightStatusLed(LED_STATUS_BLOCKING, false, false);
+            BuildEventIndex(); // Day of week may be changed
             LoadNextEvent();
         }        
+        // Staged config replaces EEPROM tables, one reload
+        if(lastCommand == MB_COMMAND_CONFIG_COMMIT && SettingsStagedApply())
+            InitFromEeprom();
+        // Answer is sent already, boot block does not return
+        if(lastCommand == MB_COMMAND_FIRMWARE_UPDATE)
+        {
+            SwitchOffAllLeds();
+            StopPlaying();
+            BootEnter(ModbusGetID());
+        }
         return;
     }
     if(*lastFunction == MB_FC_USER_COMMAND)
@@ -1146,15 +1694,36 @@ void io_poll()
         return;
     }
     
+    if(*lastFunction == MB_FC_WRITE_COIL || *lastFunction == MB_FC_WRITE_MULTIPLE_COILS)
+    {
+        CoilsWritten(ModbusTakeCoilsDirty());
+        return;
+    }
     if(*lastFunction == MB_FC_WRITE_REGISTER || *lastFunction == MB_FC_WRITE_MULTIPLE_REGISTERS)
     {
-
+        HoldingRegsWritten(ModbusTakeHoldingDirty());
+        return;
     }
     
 
     if(*lastFunction == MB_FC_WRITE_FILE_RECORD)
     {
-        InitFromEeprom();
+        // Staging is not used until commit
+        if(HIGH_BYTE(lastAddress) == MB_FILE_CONFIG_STAGE)
+        {
+            SetInputReg(INPUT_REG_FLASH_WEAR, FlashEraseCount(FLASH_STAGING_FIRST_BLOCK + LOW_BYTE(lastAddress)));
+            ModbusSetExceptionStatusBit(MB_EXCEPTION_LAST_COMMAND_STATE, true);
+            return;
+        }
+        if(HIGH_BYTE(lastAddress) == MB_FILE_FLASH)
+        {
+            SetInputReg(INPUT_REG_FLASH_WEAR, FlashEraseCount(LOW_BYTE(lastAddress)));
+            // Bank is used after block 0 with signature is written
+            if(LOW_BYTE(lastAddress) == 0 || _eventCountAddress >= STORAGE_FLASH_BANK)
+                ReloadTables(true);
+        }
+        else
+            ReloadEepromRange(lastAddress, lastEndAddress);
         ModbusSetExceptionStatusBit(MB_EXCEPTION_LAST_COMMAND_STATE, true);
 //        for(uint8_t i = 0; i < eventCount && i < MAX_EVENTS; i++)
 //            LightLed(i + 1, LED_GREEN, false);
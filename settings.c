@@ -0,0 +1,235 @@
+/******************************************************************************/
+/*Files to Include                                                            */
+/******************************************************************************/
+
+#if defined(__XC)
+    #include <xc.h>         /* XC8 General Include File */
+#elif defined(HI_TECH_C)
+    #include <htc.h>        /* HiTech General Include File */
+#elif defined(__18CXX)
+    #include <p18cxxx.h>    /* C18 General Include File */
+#endif
+
+#if defined(__XC) || defined(HI_TECH_C)
+
+#include <stdint.h>         /* For uint8_t definition */
+#include <stdbool.h>        /* For true/false definition */
+#include <eeprom_routines.h>
+
+#endif
+
+#include "system.h"
+#include "settings.h"
+#include "flash.h"
+
+#define SLOT_NONE 0xFF
+
+enum SETTINGS_RECORD
+{
+    REC_KEY = 0,
+    REC_VALUE,
+    REC_SEQ,
+    REC_CHECK
+};
+
+const uint8_t SettingKeys[SETTINGS_KEYS_COUNT] = {
+    SETTING_MODBUS_ID, SETTING_EVENT_ACCEPT_TIME, SETTING_MAX_EVENTS, SETTING_EVENT_COUNT,
+    SETTING_WATCH_CORRECTION_LO, SETTING_WATCH_CORRECTION_HI, SETTING_CONFIG_COMMIT_LEN,
+    SETTING_CONFIG_COMMIT_CRC_LO, SETTING_CONFIG_COMMIT_CRC_HI
+};
+
+uint8_t _settingSlot[SETTINGS_KEYS_COUNT]; // Newest record of key
+uint8_t _settingsHead = 0; // Next slot to write
+uint8_t _settingsSeq = 0; // Next sequence number
+
+static uint8_t SlotAddress(uint8_t slot)
+{
+    return SETTINGS_JOURNAL_START + slot * SETTINGS_RECORD_SIZE;
+}
+
+static uint8_t RecordCheck(uint8_t key, uint8_t value, uint8_t seq)
+{
+    return ~(uint8_t)(key + value + seq);
+}
+
+static uint8_t KeyIndex(uint8_t key)
+{
+    for(uint8_t i = 0; i < SETTINGS_KEYS_COUNT; i++)
+    {
+        if(SettingKeys[i] == key)
+            return i;
+    }
+    return SLOT_NONE;
+}
+
+static bool IsSlotLive(uint8_t slot)
+{
+    for(uint8_t i = 0; i < SETTINGS_KEYS_COUNT; i++)
+    {
+        if(_settingSlot[i] == slot)
+            return true;
+    }
+    return false;
+}
+
+// a newer than b, sequence numbers wrap. int8_t is plain char, unsigned
+// on XC8, so signed char is spelled out
+static bool SeqNewer(uint8_t a, uint8_t b)
+{
+    return (signed char)(a - b) > 0;
+}
+
+void SettingsInit()
+{
+    bool found = false;
+    uint8_t newestSeq = 0;
+    for(uint8_t i = 0; i < SETTINGS_KEYS_COUNT; i++)
+        _settingSlot[i] = SLOT_NONE;
+    _settingsHead = 0;
+    _settingsSeq = 0;
+
+    for(uint8_t slot = 0; slot < SETTINGS_SLOTS; slot++)
+    {
+        uint8_t address = SlotAddress(slot);
+        uint8_t key = eeprom_read(address + REC_KEY);
+        uint8_t seq = eeprom_read(address + REC_SEQ);
+        if(eeprom_read(address + REC_CHECK) != RecordCheck(key, eeprom_read(address + REC_VALUE), seq))
+            continue;
+        uint8_t keyIndex = KeyIndex(key);
+        if(keyIndex == SLOT_NONE)
+            continue;
+        uint8_t oldSlot = _settingSlot[keyIndex];
+        if(oldSlot == SLOT_NONE || SeqNewer(seq, eeprom_read(SlotAddress(oldSlot) + REC_SEQ)))
+            _settingSlot[keyIndex] = slot;
+        if(!found || SeqNewer(seq, newestSeq))
+        {
+            found = true;
+            newestSeq = seq;
+            _settingsHead = slot + 1;
+        }
+    }
+    if(_settingsHead >= SETTINGS_SLOTS)
+        _settingsHead = 0;
+    if(found)
+        _settingsSeq = newestSeq + 1;
+}
+
+bool SettingIsKey(uint8_t key)
+{
+    return KeyIndex(key) != SLOT_NONE;
+}
+
+uint8_t SettingGet(uint8_t key)
+{
+    uint8_t keyIndex = KeyIndex(key);
+    if(keyIndex == SLOT_NONE || _settingSlot[keyIndex] == SLOT_NONE)
+    {
+        if(key >= SETTINGS_JOURNAL_START)
+            return 0xFF;
+        return eeprom_read(key);
+    }
+    return eeprom_read(SlotAddress(_settingSlot[keyIndex]) + REC_VALUE);
+}
+
+// Write byte only if it differs, saves EEPROM wear and write wait
+void EepromUpdate(uint8_t address, uint8_t value)
+{
+    if(eeprom_read(address) != value)
+        eeprom_write(address, value);
+}
+
+// Write record to next free slot. Slots with live records are skipped,
+// there are always more slots than keys
+static void SettingsAppend(uint8_t keyIndex, uint8_t value)
+{
+    while(IsSlotLive(_settingsHead))
+    {
+        _settingsHead++;
+        if(_settingsHead >= SETTINGS_SLOTS)
+            _settingsHead = 0;
+    }
+    uint8_t key = SettingKeys[keyIndex];
+    uint8_t address = SlotAddress(_settingsHead);
+    // Invalidate first, old record may have the same check
+    EepromUpdate(address + REC_CHECK, ~RecordCheck(key, value, _settingsSeq));
+    EepromUpdate(address + REC_KEY, key);
+    EepromUpdate(address + REC_VALUE, value);
+    EepromUpdate(address + REC_SEQ, _settingsSeq);
+    EepromUpdate(address + REC_CHECK, RecordCheck(key, value, _settingsSeq));
+    while(WR)
+        continue;
+    _settingSlot[keyIndex] = _settingsHead;
+    _settingsSeq++;
+    _settingsHead++;
+    if(_settingsHead >= SETTINGS_SLOTS)
+        _settingsHead = 0;
+}
+
+void SettingSet(uint8_t key, uint8_t value)
+{
+    uint8_t keyIndex = KeyIndex(key);
+    if(keyIndex == SLOT_NONE)
+        return;
+    if(SettingGet(key) == value)
+        return;
+    SettingsAppend(keyIndex, value);
+
+    // Lazy compaction
+    for(uint8_t i = 0; i < SETTINGS_KEYS_COUNT; i++)
+    {
+        uint8_t slot = _settingSlot[i];
+        if(slot == SLOT_NONE)
+            continue;
+        uint8_t address = SlotAddress(slot);
+        if((uint8_t)(_settingsSeq - eeprom_read(address + REC_SEQ)) >= SETTINGS_REFRESH_AGE)
+            SettingsAppend(i, eeprom_read(address + REC_VALUE));
+    }
+}
+
+uint16_t SettingsStagedCrc(uint8_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for(uint8_t i = 0; i < len; i++)
+    {
+        crc ^= FlashRead(FLASH_STAGING_OFFSET + i);
+        for(uint8_t j = 0; j < 8; j++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+    }
+    return crc;
+}
+
+// Length goes last, it makes the commit pending
+void SettingsStageCommit(uint8_t len, uint16_t crc)
+{
+    SettingSet(SETTING_CONFIG_COMMIT_CRC_LO, (uint8_t)crc);
+    SettingSet(SETTING_CONFIG_COMMIT_CRC_HI, (uint8_t)(crc >> 8));
+    SettingSet(SETTING_CONFIG_COMMIT_LEN, len);
+}
+
+bool SettingsStagedApply()
+{
+    uint8_t len = SettingGet(SETTING_CONFIG_COMMIT_LEN);
+    if(len == 0 || len == 0xFF)
+        return false;
+    // Staging may be rewritten by master after commit, then it is dropped
+    if(SettingsStagedCrc(len) != word(SettingGet(SETTING_CONFIG_COMMIT_CRC_HI), SettingGet(SETTING_CONFIG_COMMIT_CRC_LO)))
+    {
+        SettingSet(SETTING_CONFIG_COMMIT_LEN, 0);
+        return false;
+    }
+    if(len > SETTINGS_JOURNAL_START)
+        len = SETTINGS_JOURNAL_START;
+    // Copy is repeated from start after power loss, writes are idempotent
+    for(uint8_t i = 0; i < len; i++)
+    {
+        uint8_t value = FlashRead(FLASH_STAGING_OFFSET + i);
+        if(SettingIsKey(i))
+            SettingSet(i, value);
+        else
+            EepromUpdate(i, value);
+    }
+    while(WR)
+        continue;
+    SettingSet(SETTING_CONFIG_COMMIT_LEN, 0);
+    return true;
+}
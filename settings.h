@@ -0,0 +1,48 @@
+#ifndef SETTINGS_H
+#define	SETTINGS_H
+
+// Log-structured settings store in EEPROM.
+// Every change appends record [key][value][seq][check] to the ring at the end
+// of EEPROM, check byte is written last. On boot one scan builds RAM index of
+// newest valid record for each key. Keys are legacy EEPROM addresses, without
+// record the legacy byte is used. Keys from SETTINGS_JOURNAL_START have no
+// legacy byte and read 0xFF until written.
+
+#define SETTINGS_JOURNAL_START 0xD0 // Events and sounds must end before
+#define SETTINGS_RECORD_SIZE 4
+#define SETTINGS_SLOTS ((_EEPROMSIZE - SETTINGS_JOURNAL_START) / SETTINGS_RECORD_SIZE)
+// Live record older than this is copied forward, so all records of one key
+// are less than 128 sequence numbers apart
+#define SETTINGS_REFRESH_AGE 64
+
+#define SETTING_MODBUS_ID 1
+#define SETTING_EVENT_ACCEPT_TIME 2
+#define SETTING_MAX_EVENTS 3
+#define SETTING_EVENT_COUNT 10
+#define SETTING_WATCH_CORRECTION_LO 0xF0
+#define SETTING_WATCH_CORRECTION_HI 0xF1
+#define SETTING_CONFIG_COMMIT_LEN 0xF2 // Staged bytes to copy, 0 and 0xFF - none
+#define SETTING_CONFIG_COMMIT_CRC_LO 0xF3 // SettingsStagedCrc of committed image
+#define SETTING_CONFIG_COMMIT_CRC_HI 0xF4
+#define SETTINGS_KEYS_COUNT 9
+
+void SettingsInit();
+bool SettingIsKey(uint8_t key);
+// Newest value from journal or legacy EEPROM byte
+uint8_t SettingGet(uint8_t key);
+void SettingSet(uint8_t key, uint8_t value);
+// Write EEPROM byte only if it differs
+void EepromUpdate(uint8_t address, uint8_t value);
+
+// Config upload. Master writes EEPROM image (from address 0) to flash
+// staging blocks, commit checks its CRC and marks it pending in journal
+// together with the CRC. Pending image is copied by main loop, or on boot
+// if power was lost, only while staging still has that CRC.
+// Modbus CRC16 of staged image, not byte swapped
+uint16_t SettingsStagedCrc(uint8_t len);
+void SettingsStageCommit(uint8_t len, uint16_t crc);
+// Copy pending image to EEPROM. Return false if nothing was pending or
+// staging was changed after commit
+bool SettingsStagedApply();
+
+#endif	/* SETTINGS_H */
@@ -42,7 +42,28 @@
 #define _XTAL_FREQ      SYS_FREQ
 #define FCY             SYS_FREQ/4
 
-#define TIMER_TICKS_IN_1_MS 0x10000 - FCY / 1000
+// Timer1 runs free with prescaler 8: 1 tick = 3.2 us, 1 ms = 312.5 ticks.
+// Remainder is counted in half ticks, 65536 ticks = 209 ms + 447 half ticks
+#define TIMER1_HALF_TICKS_IN_1_MS 625
+#define TIMER1_MS_PER_OVERFLOW 209
+#define TIMER1_REMAINDER_PER_OVERFLOW 447
+// Nearer deadlines are set to CCP2 compare, others are checked at overflow
+#define DEADLINE_COMPARE_MAX_MS 200
+
+// UART, also set up by boot block
+#define BAUDRATE    9600
+#define	UBRG	( (((SYS_FREQ / BAUDRATE) / 8) - 1) / 2 )
+
+// Timer3 without prescaler counts Modbus T35 silence: 3.5 characters of
+// 11 bits (4 ms at 9600 baud), fixed 1.75 ms above 19200 baud
+#if BAUDRATE > 19200
+#define TIMER3_T35_TICKS ((FCY) * 7 / 4000)
+#else
+#define TIMER3_T35_TICKS ((FCY) * 77 / (2L * BAUDRATE))
+#endif
+#if TIMER3_T35_TICKS > 0xFFFF
+#error "Modbus T35 does not fit Timer3 at this baud rate"
+#endif
 
 // 1 sec = FCY = 2 500 000 
 // 1 min = FCY * 60 = 150000000
@@ -53,6 +74,15 @@
 
 #define WATCH_TIMER_TICKS_IN_1_SEC (FCY / WATCH_TIMER_PRESCALER + WATCH_TIMER_CORRECTION)
 #define WATCH_TIMER_TICKS_TO_END_6S 0x10000 - WATCH_TIMER_TICKS_IN_1_SEC * 6
+// Learned correction, 1/256 timer tick per 6 sec period.
+// 1 sec = FCY / 256 ticks = FCY units, so 1 ms error in period = FCY / 1000 units
+#define WATCH_CORRECTION_PER_MS_IN_6S (FCY / 1000)
+#define WATCH_CORRECTION_LIMIT 7500 // ~500 ppm
+#define WATCH_CALIBRATION_MIN_INTERVAL 21600 // 6 hours between master syncs
+#define WATCH_CALIBRATION_MAX_ERROR 600 // sec, bigger is time change, not drift
+#define WATCH_CALIBRATION_MAX_DRIFT 100000 // ms
+
+#define SETTINGS_COMMIT_DELAY_MS 1000 // Holding register writes are merged within
 
 #define MODBUD_ID       0x7F
 
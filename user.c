@@ -36,9 +36,6 @@
 
 
 
-#define BAUDRATE    9600
-#define	UBRG	( (((SYS_FREQ / BAUDRATE) / 8) - 1) / 2 )
-
 time_t currentTime = 0;
 //time_t nextMinuteSeconds = 60; // When seconds equal this value? adding 1 minute
 //uint16_t minutesFromMidnight = MINUTES_NOT_SET;
@@ -88,18 +85,24 @@ void InitApp(void)
     T1CONbits.T1SYNC = 0;
     T1CONbits.TMR1CS = 0;
     // FCY = 2 500 000
-    T1CONbits.T1CKPS = 0; // Prescaler 1
+    T1CONbits.T1CKPS = 3; // Prescaler 8, free running, overflow ~209.7 ms
     
     
     
     PIE1bits.TMR1IE   = 1;  // Enable interrupt by tomer 1 (interrupt) TMR1
     IPR1bits.TMR1IP   = 1;  // Enable interrupt priority TMR1
-    WRITETIMER1(TIMER_TICKS_IN_1_MS);
+    WRITETIMER1(0);
     //TMR1L              = TIMER_TICKS_IN_1_MS_L; // ???? ???? ?? ????? ??????????? ? ???? ??????? ?? 0xFFFF
     //TMR1H              = TIMER_TICKS_IN_1_MS_H;
     PIR1bits.TMR1IF   = 0; // ??????? ???? ?????????? (????? ????? ?? ????????? ? ??????????)
     
     T1CONbits.TMR1ON = 1; // Switch on timer
+    
+    // CCP2 compare with Timer1 - deadlines, software interrupt only
+    CCP2CON = 0x0A;
+    PIE2bits.CCP2IE = 1;
+    IPR2bits.CCP2IP = 1;
+    PIR2bits.CCP2IF = 0;
     //--------------------------------------------------------------------------
     
     // Init Timer 0 (6 sec) ----------------------------------------------------
@@ -134,11 +137,21 @@ void InitApp(void)
     
     // Usart
     InitUartBuffer();   
+
+    // Timer3 - Modbus frame end (T35), started by every received byte
+    T3CON = 0;
+    T3CONbits.RD16 = 1;
+    T3CONbits.T3CKPS = 0; // 1:1
+    PIR2bits.TMR3IF = 0;
+    PIE2bits.TMR3IE = 1;
+    IPR2bits.TMR3IP = 0; // low priority, same as receiver
     
     PortBegin();
     PIE1bits.RCIE = 1; // 
     /* Make receive interrupt low priority */
     IPR1bits.RCIP = 0;
+    // Transmitter is fed from low priority interrupt too, enabled per answer
+    IPR1bits.TXIP = 0;
     
     
     	// Clearing buffers
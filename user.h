@@ -13,8 +13,96 @@
 //#define HOUR_NOT_SET 0xFF
 
 
-#define modbusInputBufLen 15
-#define modbusHoldingBufLen 15 // Led statuses
+// Modbus register map, one line per coil or register:
+// X(name, address, access, setting, on write hook)
+// address - coil or register number 0..31
+// access - MB_RO or MB_RW, writes to MB_RO or absent address are rejected
+// setting - settings key saving LO byte of written value, MB_NO_SETTING - RAM only
+// on write hook - function called with written value, MB_NO_HOOK - none
+// Addresses absent from the table read as 0.
+#define MB_RO 0
+#define MB_RW 1
+#define MB_NO_SETTING 0xFF
+#define MB_NO_HOOK(value)
+
+#define MB_COILS(X) \
+    X(COIL_FIRE,            0x00, MB_RW, MB_NO_SETTING, MB_NO_HOOK) /* Fire alarm */ \
+    X(COIL_WARNING,         0x01, MB_RW, MB_NO_SETTING, MB_NO_HOOK) /* Warning alarm */ \
+    X(COIL_ALARM,           0x02, MB_RW, MB_NO_SETTING, MB_NO_HOOK) /* Alarm! */ \
+    X(COIL_ASSAULT,         0x03, MB_RW, MB_NO_SETTING, MB_NO_HOOK) /* Assault */ \
+    X(COIL_NOT_RESPONSE,    0x04, MB_RW, MB_NO_SETTING, MB_NO_HOOK) /* NotResponse */ \
+    X(COIL_BLOCKING,        0x05, MB_RW, MB_NO_SETTING, MB_NO_HOOK) /* Blocking */ \
+    X(COIL_FAULT,           0x06, MB_RW, MB_NO_SETTING, MB_NO_HOOK) /* Fault */ \
+    X(COIL_WORKING,         0x07, MB_RW, MB_NO_SETTING, MB_NO_HOOK) /* Working */ \
+    X(COIL_CLEAR_ALL_EVENTS, 0x09, MB_RW, MB_NO_SETTING, MB_NO_HOOK) /* Clear diary */
+
+#define MB_INPUT_REGS(X) \
+    X(INPUT_REG_CHANGE_SEQ,            0, MB_RO, MB_NO_SETTING, MB_NO_HOOK) /* Incremented on any change, except clock registers */ \
+    X(INPUT_REG_CURRENT_HOUR_MIN,      1, MB_RO, MB_NO_SETTING, MB_NO_HOOK) \
+    X(INPUT_REG_EVENT_OLD_CUR_NUM,     2, MB_RO, MB_NO_SETTING, MB_NO_HOOK) \
+    X(INPUT_REG_EVENT_HOUR_MIN,        3, MB_RO, MB_NO_SETTING, MB_NO_HOOK) \
+    X(INPUT_REG_CURRENT_HOUR_MIN_2,    4, MB_RO, MB_NO_SETTING, MB_NO_HOOK) \
+    X(INPUT_REG_SECONDS,               5, MB_RO, MB_NO_SETTING, MB_NO_HOOK) \
+    X(INPUT_REG_SOUND_CNT_EVENT_COUNT, 6, MB_RO, MB_NO_SETTING, MB_NO_HOOK) \
+    X(INPUT_REG_PL_LEN_POS_IN_EE,      7, MB_RO, MB_NO_SETTING, MB_NO_HOOK) \
+    X(INPUT_REG_TOTAL_MINUTES,         8, MB_RO, MB_NO_SETTING, MB_NO_HOOK) \
+    X(INPUT_REG_SOUND_PLAYING,         9, MB_RO, MB_NO_SETTING, MB_NO_HOOK) /* HI - playing sound id, LO - its priority */ \
+    X(INPUT_REG_SOUND_QUEUE,          10, MB_RO, MB_NO_SETTING, MB_NO_HOOK) /* HI - playing request source, LO - active requests count */ \
+    X(INPUT_REG_DAY_OF_WEEK,          11, MB_RO, MB_NO_SETTING, MB_NO_HOOK) /* 0 - Monday .. 6 - Sunday, 0xFF - not set */ \
+    X(INPUT_REG_FLASH_WEAR,           12, MB_RO, MB_NO_SETTING, MB_NO_HOOK) /* Erase count of last written flash block */ \
+    X(INPUT_REG_WATCH_CORRECTION,     13, MB_RO, MB_NO_SETTING, MB_NO_HOOK) /* 1/256 watch timer tick per 6 sec */ \
+    X(INPUT_REG_UART_ERRORS,          14, MB_RO, MB_NO_SETTING, MB_NO_HOOK) /* HI - overruns, LO - framing errors */ \
+    X(INPUT_REG_BUTTONS,              15, MB_RO, MB_NO_SETTING, MB_NO_HOOK) /* Debounced inputs, bit 0 - reset button, bit 1 - intrusion, 1 - active */
+
+#define MB_HOLDING_REGS(X) \
+    X(HOLDING_EVENT_ACCEPT_TIME_S,        4, MB_RW, SETTING_EVENT_ACCEPT_TIME, SetEventAcceptTime) /* Time to react to the event in sec */ \
+    X(HOLDING_BUZZER_ESCALADE,            5, MB_RW, MB_NO_SETTING, MB_NO_HOOK) /* HI - Time from start playing to full loud, LO - Start duration divider(Duration >> x) */ \
+    X(HOLDING_EVENING_MORNING_TIME_HOUR,  6, MB_RW, MB_NO_SETTING, MB_NO_HOOK) /* Quiet buzzer|Loud buzzer start */ \
+    X(HOLDING_NIGHT_START_END_HOUR,       7, MB_RW, MB_NO_SETTING, MB_NO_HOOK) /* Mute buzzer|Quiet buzzer */ \
+    X(HOLDING_BLINK_DURATION_PERIOD,      8, MB_RW, MB_NO_SETTING, MB_NO_HOOK) /* HI - duration, ms << 6, LO - Period, ms << 6 */ \
+    X(HOLDING_REPLAY_WINDOW_MS,           9, MB_RW, MB_NO_SETTING, ModbusSetReplayWindow) /* Retried command is answered from cache within, 0 - off */
+
+// Generators for the tables above
+#define MB_REG_ENUM(name, addr, access, setting, hook) name = (addr),
+#define MB_REG_SPAN(name, addr, access, setting, hook) uint8_t r_##name[(addr) + 1];
+#define MB_REG_WRITABLE(name, addr, access, setting, hook) | ((uint32_t)(access) << (addr))
+
+enum { MB_COILS(MB_REG_ENUM) MB_INPUT_REGS(MB_REG_ENUM) MB_HOLDING_REGS(MB_REG_ENUM) };
+// Size of union is highest address + 1, counted by compiler
+union MbCoilsSpan { MB_COILS(MB_REG_SPAN) };
+union MbInputRegsSpan { MB_INPUT_REGS(MB_REG_SPAN) };
+union MbHoldingRegsSpan { MB_HOLDING_REGS(MB_REG_SPAN) };
+#define modbusCoilsCount sizeof(union MbCoilsSpan)
+#define modbusInputBufLen sizeof(union MbInputRegsSpan)
+#define modbusHoldingBufLen sizeof(union MbHoldingRegsSpan)
+// Bit per address, set if master can write it
+#define MB_COILS_WRITABLE (0 MB_COILS(MB_REG_WRITABLE))
+#define MB_HOLDING_WRITABLE (0 MB_HOLDING_REGS(MB_REG_WRITABLE))
+
+// Switch cases applying change of one coil or holding register made by
+// master: save setting and call hook. Holding register settings are
+// marked uncommitted and saved later by MB_HOLDING_COMMIT
+#define MB_COIL_WRITTEN(name, addr, access, setting, hook) \
+    case (addr): \
+        if((setting) != MB_NO_SETTING) \
+            SettingSet(setting, bitRead(_MODBUSCoils, addr)); \
+        hook(bitRead(_MODBUSCoils, addr)); \
+        break;
+#define MB_HOLDING_WRITTEN(name, addr, access, setting, hook) \
+    case (addr): \
+        if((setting) != MB_NO_SETTING) \
+            _holdingUncommitted |= 1UL << (addr); \
+        hook(_MODBUSHoldingRegs[addr]); \
+        break;
+#define MB_HOLDING_COMMIT(name, addr, access, setting, hook) \
+    case (addr): \
+        if((setting) != MB_NO_SETTING) \
+            SettingSet(setting, LOW_BYTE(_MODBUSHoldingRegs[addr])); \
+        break;
+#define MB_HOLDING_LOAD(name, addr, access, setting, hook) \
+    if((setting) != MB_NO_SETTING) \
+        ModbusRegWrite(_MODBUSHoldingRegs[addr], SettingGet(setting));
+
 uint16_t _MODBUSDiscreteInputs = 0;
 uint16_t _MODBUSCoils = 0;
 uint16_t _MODBUSInputRegs[modbusInputBufLen];
@@ -25,57 +113,6 @@ uint16_t _MODBUSHoldingRegs[modbusHoldingBufLen];
 
 /* TODO User level functions prototypes (i.e. InitApp) go here */
 
-#define ValueShift(v, shift) (v <<= shift)
-#define NotShift
-#define MbRegWithin(rAddr) (rAddr >= lastAddress && rAddr <= lastEndAddress)
-
-#define LoadMbValueAndSaveEeprom(modbusvalue, v, eeAddr, shift)\
-            v = modbusvalue; \
-            _EEREG_EEPROM_WRITE(eeAddr, v); \
-            shift;
-
-#define LoadMbValuesWithSelectableShift(modbusRegister, v1, shift1, v2, shift2, eeAddr1, eeAddr2)     \
-        if(MbRegWithin(modbusRegister))\
-        {\
-            LoadMbValueAndSaveEeprom(HIGH_BYTE(_MODBUSHoldingRegs[modbusRegister]), v1, eeAddr1, shift1)\
-            LoadMbValueAndSaveEeprom(LOW_BYTE(_MODBUSHoldingRegs[modbusRegister]), v2, eeAddr2, shift2)\
-            _MODBUSInputRegs[INPUT_REG_LAST_COMMAND_STATE] = MODBUS_RESULT_SUCCESS;\
-        }
-
-#define LoadMbUint8Values(modbusRegister, v1, v2, eeAddr1, eeAddr2)   \
-        LoadMbValuesWithSelectableShift(modbusRegister, v1, NotShift, v2, NotShift, eeAddr1, eeAddr2);
-#define LoadMbValuesWithShift(modbusRegister, v1, shift1, v2, shift2, eeAddr1, eeAddr2)   \
-        LoadMbValuesWithSelectableShift(modbusRegister, v1, ValueShift(v1, shift1), v2, ValueShift(v2, shift2), eeAddr1, eeAddr2);
-
-#define LoadMbHiValueWithShift(modbusRegister, v, eeAddr, shift)\
-        if(MbRegWithin(modbusRegister))\
-        {\
-            LoadMbValueAndSaveEeprom(HIGH_BYTE(_MODBUSHoldingRegs[modbusRegister]), v, eeAddr, ValueShift(v, shift))\
-            _MODBUSInputRegs[INPUT_REG_LAST_COMMAND_STATE] = MODBUS_RESULT_SUCCESS;\
-        }
-#define LoadMbHiValue(modbusRegister, v, eeAddr)\
-        if(MbRegWithin(modbusRegister))\
-        {\
-            LoadMbValueAndSaveEeprom(HIGH_BYTE(_MODBUSHoldingRegs[modbusRegister]), v, eeAddr, NotShift)\
-            _MODBUSInputRegs[INPUT_REG_LAST_COMMAND_STATE] = MODBUS_RESULT_SUCCESS;\
-        }
-
-#define LoadMbLoValueWithShift(modbusRegister, v, eeAddr, shift)\
-        if(MbRegWithin(modbusRegister))\
-        {\
-            LoadMbValueAndSaveEeprom(LOW_BYTE(_MODBUSHoldingRegs[modbusRegister]), v, eeAddr, ValueShift(v, shift))\
-            _MODBUSInputRegs[INPUT_REG_LAST_COMMAND_STATE] = MODBUS_RESULT_SUCCESS;\
-        }
-#define LoadMbLoValue(modbusRegister, v, eeAddr)\
-        if(MbRegWithin(modbusRegister))\
-        {\
-            LoadMbValueAndSaveEeprom(LOW_BYTE(_MODBUSHoldingRegs[modbusRegister]), v, eeAddr, NotShift)\
-            _MODBUSInputRegs[modbusRegister] = _MODBUSHoldingRegs[modbusRegister]; /* For debug*/\
-            _MODBUSInputRegs[INPUT_REG_LAST_COMMAND_STATE] = MODBUS_RESULT_SUCCESS;\
-        }
-
-
-
 #define _EEREG_EEPROM_WRITE(addr, value)	\
 do{											\
 	while (WR) { 							\